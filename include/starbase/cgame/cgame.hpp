@@ -21,11 +21,14 @@ protected:
 	Renderer m_renderer;
 	Camera m_camera;
 
+	// Reused every frame, see Render()
+	Renderer::PrepareBatch m_prepareBatch;
+
 	entity_id m_playerEntityId;
 
 	bool HandleSDLEvent(SDL_Event event);
 
-	entity_id AddTestEntity(const char* id, const Transform& transf);
+	entity_id AddTestEntity(const char* id, const Transform& transf, const Scale& scale = Scale(), const glm::vec2& vel = glm::vec2());
 
 public:
 	CGame(Display& m_display, IFilesystem& filesystem, UI::MainWindow& mainWindow);
@@ -3,12 +3,21 @@
 #include <cstdint>
 #include <memory>
 
+#include <glm/mat4x4.hpp>
+
 #include <starbase/cgame/resource/model.hpp>
+#include <starbase/game/entity/template/shared.hpp>
 
 namespace Starbase {
 
+// Model resource shared by all entities with the same model
+using SharedModel = TShared<ResourcePtr<Model>>;
+
 struct Renderable {
-	ResourcePtr<Model> model;
+	SharedModel model;
+
+	// Model-view-projection matrix of the frame being drawn, set by EntityRenderer::Prepare()
+	glm::mat4 mvp;
 
 	Renderable()
 	{}
@@ -16,6 +25,10 @@ struct Renderable {
 	Renderable(const ResourcePtr<Model>& model)
 		: model(model)
 	{}
+
+	Renderable(SharedModel model)
+		: model(model)
+	{}
 };
 
 } // namespace Starbase
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <vector>
 #include <unordered_map>
 
@@ -7,6 +8,7 @@
 
 #include <starbase/game/fwd.hpp>
 #include <starbase/game/entity/eventmanager.hpp>
+#include <starbase/game/entity/template/soa_vector.hpp>
 
 #include <starbase/cgame/fwd.hpp>
 #include <starbase/cgame/renderer/renderparams.hpp>
@@ -81,12 +83,35 @@ public:
 	struct ComponentGroup {
 		const Entity& ent;
 		const Transform& trans;
+		const Scale& scale;
 		const Renderable& rend;
 		const Physics* phys;
 		const ShipControls* contr;
 
-		ComponentGroup(const Entity& ent, const Transform& trans, const Renderable& rend, const Physics* phys, const ShipControls* contr)
-			: ent(ent), trans(trans), rend(rend), phys(phys), contr(contr) {}
+		ComponentGroup(const Entity& ent, const Transform& trans, const Scale& scale, const Renderable& rend, const Physics* phys, const ShipControls* contr)
+			: ent(ent), trans(trans), scale(scale), rend(rend), phys(phys), contr(contr) {}
+	};
+
+	// What the render matrix of an entity is computed from
+	struct PrepareInput {
+		float posX, posY;
+		float prevPosX, prevPosY;
+		float rot;
+		float scaleX, scaleY;
+	};
+
+	// Entities to prepare for a frame, with their inputs gathered in lanes, so
+	// that Prepare() processes several entities at a time
+	struct PrepareBatch {
+		TSoAVector<PrepareInput> inputs;
+		std::vector<Renderable*> renderables;
+
+		std::size_t Size() const
+		{ return renderables.size(); }
+
+		void Clear();
+
+		void Add(const Transform& trans, const Scale& scale, Renderable& rend);
 	};
 
 private:
@@ -97,13 +122,14 @@ private:
 	LineShader m_lineShader;
 	PathShader m_pathShader;
 
-	std::unordered_map<id_t, ModelGL> m_modelsGL;
-	std::unordered_map<id_t, BodyGL> m_bodiesGL;
+	// GL objects by the index of the shared model and body of the entities
+	std::vector<std::unique_ptr<ModelGL>> m_modelsGL;
+	std::vector<std::unique_ptr<BodyGL>> m_bodiesGL;
 
 private:
 	void NormalDraw(double alpha, const ComponentGroup& cg);
 
-	void DebugDraw(double alpha, const Entity& ent, const Transform& trans, const Physics& physics);
+	void DebugDraw(double alpha, const Entity& ent, const Transform& trans, const Scale& scale, const Physics& physics);
 
 	void RenderableAdded(const Renderable& rend);
 
@@ -118,6 +144,11 @@ public:
 
 	bool Init();
 
+	// Computes the per-frame render data of the entities [begin, end) of a
+	// batch. Doesn't touch GL, so disjoint ranges may be prepared on multiple
+	// threads.
+	void Prepare(double alpha, PrepareBatch& batch, std::size_t begin, std::size_t end) const;
+
 	void Draw(double alpha, const ComponentGroup& cg);
 };
 
@@ -64,6 +64,7 @@ private:
 
 public:
 	typedef EntityRenderer::ComponentGroup ComponentGroup;
+	typedef EntityRenderer::PrepareBatch PrepareBatch;
 
 	RenderParams m_renderParams;
 
@@ -77,6 +78,8 @@ public:
 
 	void BeginDraw();
 
+	void Prepare(double alpha, PrepareBatch& batch, std::size_t begin, std::size_t end) const;
+
 	void Draw(double alpha, const ComponentGroup& cg);
 
 	void EndDraw();
@@ -5,6 +5,7 @@
 #include <glm/vec2.hpp>
 
 #include <chipmunk/chipmunk.h>
+#include <chipmunk/cpHastySpace.h>
 
 namespace Starbase {
 
@@ -60,6 +61,15 @@ struct cpSpaceDeleter {
 	}
 };
 
+// Hasty spaces must be freed by their own function, which stops their threads
+struct cpHastySpaceDeleter {
+	void operator()(cpSpace* space) const
+	{
+		if (space != nullptr)
+			cpHastySpaceFree(space);
+	}
+};
+
 typedef std::unique_ptr<cpShape, cpShapeDeleter> cpShapeUniquePtr;
 typedef std::unique_ptr<cpBody, cpBodyDeleter> cpBodyUniquePtr;
 typedef std::unique_ptr<cpSpace, cpSpaceDeleter> cpSpaceUniquePtr;
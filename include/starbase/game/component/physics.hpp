@@ -6,13 +6,27 @@
 
 #include <starbase/game/id.hpp>
 #include <starbase/game/resource/body.hpp>
+#include <starbase/game/entity/template/shared.hpp>
 #include <starbase/game/chipmunk_safe.hpp>
 
 namespace Starbase {
 
+// Body resource shared by all entities with the same body
+using SharedBody = TShared<ResourcePtr<Body>>;
+
 struct Physics {
 	id_t spaceId;
-	ResourcePtr<Body> body;
+	SharedBody body;
+
+	// Given to the chipmunk shapes, selects the collision handlers; 0 for none
+	id_t collisionType;
+
+	// Sources gravity for all bodies of its space; other bodies only receive
+	// it, see PhysicsSystem::SetAttractorMass for heavy ones
+	bool attractor;
+
+	// Velocity the body is created with; afterwards it's the one of cp.body
+	glm::vec2 initialVel;
 
 	struct {
 		entity_id entity;
@@ -25,12 +39,40 @@ struct Physics {
 	} cp;
 
 	Physics()
+		: collisionType(0)
+		, attractor(false)
+		, initialVel(0.f, 0.f)
+	{}
+
+	Physics(id_t spaceId, const ResourcePtr<Body>& body, id_t collisionType = 0, bool attractor = false)
+		: spaceId(spaceId)
+		, body(body)
+		, collisionType(collisionType)
+		, attractor(attractor)
+		, initialVel(0.f, 0.f)
 	{}
 
-	Physics(id_t spaceId, const ResourcePtr<Body>& body)
+	Physics(id_t spaceId, SharedBody body, id_t collisionType = 0, bool attractor = false)
 		: spaceId(spaceId)
 		, body(body)
+		, collisionType(collisionType)
+		, attractor(attractor)
+		, initialVel(0.f, 0.f)
+	{}
+
+	// Copies only the definition, e.g. of a prefab; the chipmunk objects
+	// belong to one entity, and are created for it by PhysicsSystem
+	Physics(const Physics& other)
+		: spaceId(other.spaceId)
+		, body(other.body)
+		, collisionType(other.collisionType)
+		, attractor(other.attractor)
+		, initialVel(other.initialVel)
 	{}
+
+	Physics(Physics&&) = default;
+
+	Physics& operator=(Physics&&) = default;
 };
 
 } // namespace Starbase
\ No newline at end of file
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+
+namespace Starbase {
+
+// Size of an entity relative to its model, applied to its body and drawing.
+// Drawn entities need one; the body of an entity without one isn't scaled.
+struct Scale {
+	glm::vec2 value;
+
+	Scale()
+		: value(1.f, 1.f)
+	{}
+
+	Scale(glm::vec2 value)
+		: value(value)
+	{}
+};
+
+} // namespace Starbase
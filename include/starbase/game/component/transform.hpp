@@ -4,31 +4,22 @@
 
 namespace Starbase {
 
+// Placement of an entity, rewritten every step. Only the fields every system
+// needs live here, to keep the most iterated component small; the scale,
+// which hardly ever changes, is a component of its own, and the velocity is
+// the one of the chipmunk body.
 struct Transform {
     glm::vec2 pos;
 	glm::vec2 prevPos;
     float rot;
-	glm::vec2 scale;
-	glm::vec2 vel;
 
 	Transform()
-		: scale(1.f, 1.f)
-		, rot(0.f)
+		: rot(0.f)
 	{}
 
-	Transform(glm::vec2 pos, float rot, glm::vec2 scale, glm::vec2 vel)
+	Transform(glm::vec2 pos, float rot)
 		: pos(pos)
-		, scale(scale)
 		, rot(rot)
-		, vel(vel)
-	{}
-
-	Transform(glm::vec2 pos, float rot, glm::vec2 scale)
-		: Transform(pos, rot, scale, glm::vec2{})
-	{}
-
-	Transform(glm::vec2 pos, float rot)
-		: Transform(pos, rot, glm::vec2(1.f, 1.f))
 	{}
 
 	Transform(glm::vec2 pos)
@@ -36,4 +27,4 @@ struct Transform {
 	{}
 };
 
-} // namespace Starbase
\ No newline at end of file
+} // namespace Starbase
@@ -3,22 +3,33 @@
 #include "template/component_list.hpp"
 
 #include <starbase/game/component/transform.hpp>
+#include <starbase/game/component/scale.hpp>
 #include <starbase/game/component/physics.hpp>
 #include <starbase/game/component/shipcontrols.hpp>
 #include <starbase/game/component/autodestruct.hpp>
 
+namespace Starbase {
+#ifdef STARBASE_ARCHETYPE_STORAGE
+	template<typename ...ComponentTypes>
+	using TGameComponentList = TArchetypeComponentList<ComponentTypes...>;
+#else
+	template<typename ...ComponentTypes>
+	using TGameComponentList = TComponentList<ComponentTypes...>;
+#endif
+}
+
 #ifdef STARBASE_CLIENT
 
 #include <starbase/cgame/component/renderable.hpp>
 
 namespace Starbase {
-	using ComponentList = TComponentList<Transform, Physics, ShipControls, AutoDestruct, Renderable>;
+	using ComponentList = TGameComponentList<Transform, Scale, Physics, ShipControls, AutoDestruct, Renderable>;
 }
 
 #else
 
 namespace Starbase {
-	using ComponentList = TComponentList<Transform, Physics, ShipControls, AutoDestruct>;
+	using ComponentList = TGameComponentList<Transform, Scale, Physics, ShipControls, AutoDestruct>;
 }
 
 #endif /* STARBASE_SERVER */
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <glm/vec2.hpp>
+
 #include "entity.hpp"
 #include "template/event_list.hpp"
 
@@ -11,12 +13,31 @@ struct TextEvent {
 	TextEvent(const std::string& text) : text(text) {}
 };
 
+// Two bodies starting or ceasing to touch, see PhysicsSystem::AddCollisionHandler().
+// first has the first collision type of the handler, second the other one.
 template<typename Entity>
 struct TCollisionEvent {
-	Entity& first;
-	Entity& second;
+	enum Phase {
+		begin,
+		separate
+	};
+
+	entity_id first;
+	entity_id second;
+	Phase phase;
+
+	// First contact point, in world coordinates
+	glm::vec2 point;
+
+	// Impulse applied to resolve the collision in the step it began; zero
+	// for separations and for shapes that don't collide, e.g. sensors
+	glm::vec2 impulse;
+
+	TCollisionEvent(entity_id first, entity_id second)
+		: first(first), second(second), phase(begin), point(0.f), impulse(0.f) {}
 
-	TCollisionEvent(Entity& first, Entity& second) : first(first), second(second) {}
+	TCollisionEvent(entity_id first, entity_id second, Phase phase, const glm::vec2& point)
+		: first(first), second(second), phase(phase), point(point), impulse(0.f) {}
 };
 
 template<typename Entity>
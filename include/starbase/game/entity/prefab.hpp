@@ -0,0 +1,8 @@
+#pragma once
+
+#include "template/prefab.hpp"
+#include "component_list.hpp"
+
+namespace Starbase {
+	using Prefab = TPrefab<ComponentList>;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include <starbase/game/id.hpp>
+#include <starbase/game/resource/resourceloader.hpp>
+#include <starbase/game/entity/prefab.hpp>
+
+namespace Starbase {
+
+// Prefabs of the models, built from the "prefab" section of their yml config:
+//
+//   prefab:
+//       transform:
+//           scale: 10
+//       physics:
+//           space: TEST_SPACE
+//       autodestruct:
+//           ttl: 400
+//       renderable: {}
+//
+// The listed components are added to the prefab, with the body and model
+// resources of the model resolved; a transform comes with a Scale. A model
+// without the section gets a Transform, a Scale, a Physics and a Renderable.
+// Prefabs are built once, and kept along with their resources until the
+// registry is destroyed.
+class PrefabRegistry {
+private:
+	ResourceLoader& m_resourceLoader;
+
+	// Prefabs are never moved, so the references handed out stay valid
+	std::unordered_map<id_t, std::unique_ptr<const Prefab>> m_prefabs;
+
+	// Guards m_prefabs, as systems running concurrently may look up prefabs
+	std::mutex m_mutex;
+
+	std::unique_ptr<const Prefab> Create(id_t id);
+
+public:
+	PrefabRegistry(ResourceLoader& resourceLoader) : m_resourceLoader(resourceLoader) {}
+
+	// Returns the prefab of a model, building it on first use. Callers that
+	// instantiate it often, like weapons, are to keep the reference.
+	const Prefab& Load(id_t id);
+};
+
+} // namespace Starbase
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+
+#include "component_list.hpp"
+#include "entity.hpp"
+#include "entity_stats.hpp"
+
+namespace Starbase {
+
+// Archetype component storage of TEntityManager. Entities sharing the same
+// component bitset are packed together in fixed-size chunks, where every
+// component type has its own contiguous array. Queries walk the matching
+// chunks linearly, without any per-entity lookups.
+template<typename CL>
+class TArchetypeStorage {
+public:
+	using Entity = TEntity<CL>;
+
+	using component_bitset = typename Entity::component_bitset;
+
+	// Size of a single chunk; the number of entities per chunk depends on the
+	// size of the components in the archetype
+	static constexpr std::size_t CHUNK_BYTES = 16 * 1024;
+
+private:
+	using slot_type = std::uint32_t;
+
+	struct Chunk {
+		// Entity slots first, followed by one array per component type
+		std::unique_ptr<unsigned char[]> data;
+		std::size_t count;
+	};
+
+	struct Archetype {
+		component_bitset bitset;
+		std::size_t capacity;
+		std::size_t chunkBytes;
+		std::array<std::size_t, CL::count> offsets;
+
+		// Archetype indices reached by adding or removing a component, -1 if not looked up yet
+		std::array<int, CL::count> addEdges;
+		std::array<int, CL::count> removeEdges;
+
+		// All chunks are full, except the last one
+		std::vector<Chunk> chunks;
+	};
+
+	struct Location {
+		int archetype;
+		std::uint32_t chunk;
+		std::uint32_t row;
+	};
+
+	std::vector<Archetype> m_archetypes;
+
+	// Bitset of every archetype, packed for fast query matching
+	std::vector<component_bitset> m_archetypeMasks;
+	std::unordered_map<component_bitset, int> m_archetypesIndex;
+
+	// For each entity slot, where its components are stored
+	std::vector<Location> m_locations;
+
+	int FindOrCreateArchetype(const component_bitset& bitset);
+
+	template<typename C>
+	int GetEdge(int archetype, bool add);
+
+	static slot_type* GetSlots(Chunk& chunk);
+
+	template<typename C>
+	static C* GetColumn(const Archetype& archetype, Chunk& chunk);
+
+	Location AllocateRow(int archetype, std::size_t slot);
+
+	void FreeRow(const Location& loc);
+
+	void MoveRow(const Location& from, const Location& to);
+
+	void DestroyRow(const Location& loc);
+
+public:
+	TArchetypeStorage() {}
+
+	TArchetypeStorage(const TArchetypeStorage&) = delete;
+	TArchetypeStorage& operator=(const TArchetypeStorage&) = delete;
+
+	~TArchetypeStorage();
+
+	// Allocates a row in the archetype of bitset; components are constructed by Emplace()
+	void Insert(std::size_t slot, const component_bitset& bitset);
+
+	// Makes room for count entities in the archetype of bitset, in slots below slotCount
+	void Reserve(const component_bitset& bitset, std::size_t slotCount, std::size_t count);
+
+	// Constructs one of the initial components of an inserted entity
+	template<typename C, typename... Args>
+	C& Emplace(std::size_t slot, Args&&... args);
+
+	// Moves an entity currently owning the components in bitset to the archetype with C
+	template<typename C, typename... Args>
+	C& Add(std::size_t slot, const component_bitset& bitset, Args&&... args);
+
+	template<typename C>
+	C& Get(std::size_t slot);
+
+	// Moves an entity to the archetype without C, which keeps the components in bitset
+	template<typename C>
+	void Remove(std::size_t slot, const component_bitset& bitset);
+
+	// Removes all components of an entity
+	void Erase(std::size_t slot, const component_bitset& bitset);
+
+	// Releases spare capacity; rows are packed on removal already
+	void Compact();
+
+	// Returns the number of entities looked at
+	template<typename ...Cs, typename F>
+	std::size_t ForEach(const std::vector<Entity>& entities, F fun);
+
+	// Calls fun(slots, components, count) for each contiguous array of C
+	template<typename C, typename F>
+	void ForEachArray(F fun);
+
+	// Live components and capacity of C, over all archetypes containing it.
+	// Entities reach their components through the shared location table.
+	template<typename C>
+	ComponentStats GetStats() const;
+
+	// Memory not belonging to a single component type: entity slots in the
+	// chunks, locations and archetype bookkeeping
+	std::size_t GetSharedBytes() const;
+};
+
+} // namespace Starbase
+
+#include "detail/archetype_storage.inl"
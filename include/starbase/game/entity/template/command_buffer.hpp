@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "entity.hpp"
+
+namespace Starbase {
+
+// Records structural changes (entity creation and removal, adding and removing
+// components) to be played back later by TEntityManager::Update(). Commands
+// are constructed in place in a linear arena, whose blocks are reused after
+// every playback, so recording doesn't allocate once the buffer is warm.
+template<typename CL>
+class TCommandBuffer {
+public:
+	struct Command {
+		// Applies the command; its payload may be moved from afterwards
+		void (*play)(TEntityManager<CL>&, Command&);
+
+		// Calls the destructor of the command
+		void (*destroy)(Command&);
+
+		// Component with the given index carried by the command, or nullptr
+		void* (*find)(Command&, int index);
+
+		Command* next;
+		entity_id id;
+	};
+
+private:
+	static constexpr std::size_t BLOCK_BYTES = 64 * 1024;
+
+	struct Block {
+		std::unique_ptr<unsigned char[]> data;
+		std::size_t size;
+	};
+
+	std::vector<Block> m_blocks;
+	std::size_t m_block;
+	std::size_t m_offset;
+
+	Command* m_first;
+	Command* m_last;
+
+	void* Allocate(std::size_t size, std::size_t alignment);
+
+	template<typename T>
+	T& Append(T* command);
+
+	// Offset of the payload from the command, aligned for any component
+	template<typename T>
+	static constexpr std::size_t PayloadOffset()
+	{ return (sizeof(T) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1); }
+
+public:
+	TCommandBuffer();
+
+	~TCommandBuffer();
+
+	TCommandBuffer(const TCommandBuffer&) = delete;
+	TCommandBuffer& operator=(const TCommandBuffer&) = delete;
+
+	bool Empty() const
+	{ return m_first == nullptr; }
+
+	// Number of commands recorded
+	std::size_t Size() const;
+
+	// Memory held by the arena, used or not
+	std::size_t BytesHeld() const;
+
+	// Constructs a command of type T, which derives from Command, at the end of the buffer
+	template<typename T, typename... Args>
+	T& Record(Args&&... args);
+
+	// Same as Record(), followed by payloadBytes for data of a size known only
+	// at runtime, at PayloadOf(command); T constructs and destroys the data
+	template<typename T, typename... Args>
+	T& RecordWithPayload(std::size_t payloadBytes, Args&&... args);
+
+	// Start of the payload of a command recorded by RecordWithPayload()
+	template<typename T>
+	static unsigned char* PayloadOf(T& command);
+
+	template<typename F>
+	void ForEach(F fun);
+
+	// Plays back all commands in recording order, including the ones recorded
+	// while playing back, and empties the buffer
+	void Play(TEntityManager<CL>& entityManager);
+
+	// Empties the buffer without playing back
+	void Clear();
+
+	// Releases the blocks beyond the first one, which a burst of commands left
+	// behind. Only allowed while the buffer is empty.
+	void Trim();
+};
+
+} // namespace Starbase
+
+#include "detail/command_buffer.inl"
@@ -1,18 +1,25 @@
 #pragma once
 
 #include <vector>
-#include <map>
 #include <unordered_map>
 #include <tuple>
 #include <functional>
 
-#include <wink/signal.hpp>
-
 #include "entity.hpp"
+#include "signal.hpp"
 #include "detail/tmp.hpp"
 
 namespace Starbase {
 
+template<typename C>
+class TComponentPool;
+
+template<typename CL>
+class TPoolStorage;
+
+template<typename CL>
+class TArchetypeStorage;
+
 template<typename ...ComponentTypes>
 struct TComponentList {
 	static constexpr std::size_t count{ sizeof...(ComponentTypes) };
@@ -25,16 +32,22 @@ struct TComponentList {
 
 	typedef std::tuple<ComponentTypes...> types;
 
-	typedef std::tuple<std::vector<ComponentTypes>...> vector_type;
-	typedef std::tuple<std::map<entity_id, ComponentTypes>...> map_type;
-	typedef std::tuple<std::vector<ComponentTypes*>...> freelist_type;
-	typedef std::vector<std::unordered_map<entity_id, int>> index_type;
+	typedef std::tuple<TComponentPool<ComponentTypes>...> pool_type;
+
+	// Component storage backend used by TEntityManager
+	using storage_type = TPoolStorage<TComponentList>;
 
     template<typename EntityType, typename C>
-	using signal_type_one = wink::signal<std::function<void(EntityType&, C&)>>;
+	using signal_type_one = TSignal<void(EntityType&, C&)>;
 
 	template<typename EntityType>
     using signal_type = std::tuple<signal_type_one<EntityType, ComponentTypes>...>;
 };
 
+// Same components as TComponentList, but stored in archetype chunks
+template<typename ...ComponentTypes>
+struct TArchetypeComponentList : TComponentList<ComponentTypes...> {
+	using storage_type = TArchetypeStorage<TArchetypeComponentList>;
+};
+
 } // namespace Starbase
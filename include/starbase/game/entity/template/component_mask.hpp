@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace Starbase {
+
+// Fixed-width set of component indices, like std::bitset, but usable in
+// constant expressions. Operations work on whole 64-bit words without
+// branches, so compilers unroll and vectorize them for wide masks.
+template<std::size_t N>
+class TComponentMask {
+public:
+	using word_type = std::uint64_t;
+
+	static constexpr std::size_t WORD_BITS = 64;
+	static constexpr std::size_t WORDS = (N + WORD_BITS - 1) / WORD_BITS;
+
+private:
+	word_type m_words[WORDS];
+
+public:
+	constexpr TComponentMask()
+		: m_words{}
+	{}
+
+	static constexpr std::size_t size()
+	{ return N; }
+
+	constexpr bool test(std::size_t index) const;
+
+	constexpr bool operator[](std::size_t index) const
+	{ return test(index); }
+
+	constexpr TComponentMask& set(std::size_t index, bool value = true);
+
+	constexpr TComponentMask& reset();
+
+	constexpr bool any() const;
+
+	constexpr bool none() const
+	{ return !any(); }
+
+	std::size_t count() const;
+
+	// True if all components of mask are in this one, i.e. (*this & mask) == mask
+	constexpr bool contains(const TComponentMask& mask) const;
+
+	constexpr TComponentMask& operator&=(const TComponentMask& other);
+
+	constexpr TComponentMask& operator|=(const TComponentMask& other);
+
+	constexpr bool operator==(const TComponentMask& other) const;
+
+	constexpr bool operator!=(const TComponentMask& other) const
+	{ return !(*this == other); }
+
+	std::size_t hash() const;
+};
+
+template<std::size_t N>
+constexpr TComponentMask<N> operator&(TComponentMask<N> a, const TComponentMask<N>& b)
+{ return a &= b; }
+
+template<std::size_t N>
+constexpr TComponentMask<N> operator|(TComponentMask<N> a, const TComponentMask<N>& b)
+{ return a |= b; }
+
+// Tests a chunk of masks against one query mask. Writes the indices of the
+// masks containing it to matches, which must have room for count entries,
+// and returns how many matched.
+template<std::size_t N>
+std::size_t FilterContaining(const TComponentMask<N>* masks, std::size_t count, const TComponentMask<N>& mask, std::uint32_t* matches);
+
+} // namespace Starbase
+
+namespace std {
+
+template<std::size_t N>
+struct hash<Starbase::TComponentMask<N>> {
+	std::size_t operator()(const Starbase::TComponentMask<N>& mask) const
+	{ return mask.hash(); }
+};
+
+} // namespace std
+
+#include "detail/component_mask.inl"
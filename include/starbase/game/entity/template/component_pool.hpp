@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "entity_stats.hpp"
+
+namespace Starbase {
+
+// Sparse set holding the components of one type: components are packed
+// in a dense array, and a sparse array maps entity slots to dense indices.
+// Removal moves the last component into the hole, so the dense array never
+// contains dead components.
+template<typename C>
+class TComponentPool {
+public:
+	static constexpr std::int32_t npos = -1;
+
+private:
+	std::vector<C> m_dense;
+	std::vector<std::uint32_t> m_slots;
+	std::vector<std::int32_t> m_sparse;
+
+public:
+	bool Contains(std::size_t slot) const;
+
+	template<typename... Args>
+	C& Add(std::size_t slot, Args&&... args);
+
+	C& Get(std::size_t slot);
+
+	void Remove(std::size_t slot);
+
+	// Makes room for count more components, in slots below slotCount
+	void Reserve(std::size_t slotCount, std::size_t count);
+
+	// Sorts the dense array by slot and releases spare capacity
+	void Compact();
+
+	std::size_t Size() const
+	{ return m_dense.size(); }
+
+	ComponentStats GetStats() const;
+
+	// Entity slot of each component in the dense array
+	const std::vector<std::uint32_t>& GetSlots() const
+	{ return m_slots; }
+
+	C* GetData()
+	{ return m_dense.data(); }
+};
+
+} // namespace Starbase
+
+#include "detail/component_pool.inl"
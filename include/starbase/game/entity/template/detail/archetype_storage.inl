@@ -0,0 +1,396 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <algorithm>
+#include <new>
+#include <tuple>
+
+#include <starbase/starbase.hpp>
+
+#include "tmp.hpp"
+
+namespace Starbase {
+
+#define TARCHETYPESTORAGE_TEMPLATE \
+template<typename CL>
+
+#define TARCHETYPESTORAGE_DECL \
+TArchetypeStorage<CL>
+
+TARCHETYPESTORAGE_TEMPLATE
+int TARCHETYPESTORAGE_DECL::FindOrCreateArchetype(const component_bitset& bitset)
+{
+	auto iter = m_archetypesIndex.find(bitset);
+	if (iter != m_archetypesIndex.end()) {
+		return iter->second;
+	}
+
+	Archetype arch;
+	arch.bitset = bitset;
+	arch.offsets.fill(0);
+	arch.addEdges.fill(-1);
+	arch.removeEdges.fill(-1);
+
+	std::size_t rowBytes = sizeof(slot_type);
+	TMP::ForEach<typename CL::types>([&](auto type_holder) {
+		(void)type_holder; using C = typename decltype(type_holder)::type;
+		if (Entity::template HasComponent<C>(bitset))
+			rowBytes += sizeof(C);
+	});
+
+	arch.capacity = std::max<std::size_t>(1, CHUNK_BYTES / rowBytes);
+
+	// Lay out the component arrays after the entity slots, each aligned for its type
+	std::size_t offset = arch.capacity * sizeof(slot_type);
+	TMP::ForEach<typename CL::types>([&](auto type_holder) {
+		(void)type_holder; using C = typename decltype(type_holder)::type;
+		static_assert(alignof(C) <= alignof(std::max_align_t), "Over-aligned components are not supported");
+
+		if (Entity::template HasComponent<C>(bitset)) {
+			offset = (offset + alignof(C) - 1) / alignof(C) * alignof(C);
+			arch.offsets[CL::template indexOf<C>()] = offset;
+			offset += arch.capacity * sizeof(C);
+		}
+	});
+	arch.chunkBytes = offset;
+
+	const int index = static_cast<int>(m_archetypes.size());
+	m_archetypes.emplace_back(std::move(arch));
+	m_archetypeMasks.push_back(bitset);
+	m_archetypesIndex.emplace(bitset, index);
+
+	return index;
+}
+
+TARCHETYPESTORAGE_TEMPLATE
+template<typename C>
+int TARCHETYPESTORAGE_DECL::GetEdge(int archetype, bool add)
+{
+	const int componentIndex = CL::template indexOf<C>();
+	const int edge = add
+		? m_archetypes[archetype].addEdges[componentIndex]
+		: m_archetypes[archetype].removeEdges[componentIndex];
+
+	if (SB_LIKELY(edge >= 0))
+		return edge;
+
+	component_bitset bitset = m_archetypes[archetype].bitset;
+	bitset.set(componentIndex, add);
+
+	// may reallocate m_archetypes, so don't hold on to references
+	const int target = FindOrCreateArchetype(bitset);
+
+	if (add)
+		m_archetypes[archetype].addEdges[componentIndex] = target;
+	else
+		m_archetypes[archetype].removeEdges[componentIndex] = target;
+
+	return target;
+}
+
+TARCHETYPESTORAGE_TEMPLATE
+auto TARCHETYPESTORAGE_DECL::GetSlots(Chunk& chunk) -> slot_type*
+{
+	return reinterpret_cast<slot_type*>(chunk.data.get());
+}
+
+TARCHETYPESTORAGE_TEMPLATE
+template<typename C>
+C* TARCHETYPESTORAGE_DECL::GetColumn(const Archetype& archetype, Chunk& chunk)
+{
+	return reinterpret_cast<C*>(chunk.data.get() + archetype.offsets[CL::template indexOf<C>()]);
+}
+
+TARCHETYPESTORAGE_TEMPLATE
+auto TARCHETYPESTORAGE_DECL::AllocateRow(int archetype, std::size_t slot) -> Location
+{
+	Archetype& arch = m_archetypes[archetype];
+
+	if (arch.chunks.empty() || arch.chunks.back().count == arch.capacity) {
+		arch.chunks.emplace_back(Chunk{ std::unique_ptr<unsigned char[]>(new unsigned char[arch.chunkBytes]), 0 });
+	}
+
+	Chunk& chunk = arch.chunks.back();
+	const Location loc{
+		archetype,
+		static_cast<std::uint32_t>(arch.chunks.size() - 1),
+		static_cast<std::uint32_t>(chunk.count++)
+	};
+
+	GetSlots(chunk)[loc.row] = static_cast<slot_type>(slot);
+
+	if (m_locations.size() <= slot)
+		m_locations.resize(slot + 1);
+	m_locations[slot] = loc;
+
+	return loc;
+}
+
+TARCHETYPESTORAGE_TEMPLATE
+void TARCHETYPESTORAGE_DECL::FreeRow(const Location& loc)
+{
+	// The row no longer holds any live components; fill the hole with the last row
+	Archetype& arch = m_archetypes[loc.archetype];
+	Chunk& lastChunk = arch.chunks.back();
+
+	const Location last{
+		loc.archetype,
+		static_cast<std::uint32_t>(arch.chunks.size() - 1),
+		static_cast<std::uint32_t>(lastChunk.count - 1)
+	};
+
+	if (last.chunk != loc.chunk || last.row != loc.row) {
+		MoveRow(last, loc);
+
+		const slot_type moved = GetSlots(lastChunk)[last.row];
+		GetSlots(arch.chunks[loc.chunk])[loc.row] = moved;
+		m_locations[moved] = loc;
+	}
+
+	if (--lastChunk.count == 0) {
+		arch.chunks.pop_back();
+	}
+}
+
+TARCHETYPESTORAGE_TEMPLATE
+void TARCHETYPESTORAGE_DECL::MoveRow(const Location& from, const Location& to)
+{
+	// Components missing in the destination archetype are destroyed
+	Archetype& fromArch = m_archetypes[from.archetype];
+	Archetype& toArch = m_archetypes[to.archetype];
+	Chunk& fromChunk = fromArch.chunks[from.chunk];
+	Chunk& toChunk = toArch.chunks[to.chunk];
+
+	TMP::ForEach<typename CL::types>([&](auto type_holder) {
+		(void)type_holder; using C = typename decltype(type_holder)::type;
+		if (Entity::template HasComponent<C>(fromArch.bitset)) {
+			C& com = this->template GetColumn<C>(fromArch, fromChunk)[from.row];
+
+			if (Entity::template HasComponent<C>(toArch.bitset))
+				new (this->template GetColumn<C>(toArch, toChunk) + to.row) C(std::move(com));
+
+			com.~C();
+		}
+	});
+}
+
+TARCHETYPESTORAGE_TEMPLATE
+void TARCHETYPESTORAGE_DECL::DestroyRow(const Location& loc)
+{
+	Archetype& arch = m_archetypes[loc.archetype];
+	Chunk& chunk = arch.chunks[loc.chunk];
+
+	TMP::ForEach<typename CL::types>([&](auto type_holder) {
+		(void)type_holder; using C = typename decltype(type_holder)::type;
+		if (Entity::template HasComponent<C>(arch.bitset))
+			this->template GetColumn<C>(arch, chunk)[loc.row].~C();
+	});
+}
+
+TARCHETYPESTORAGE_TEMPLATE
+TARCHETYPESTORAGE_DECL::~TArchetypeStorage()
+{
+	for (std::size_t a = 0; a < m_archetypes.size(); a++) {
+		const std::vector<Chunk>& chunks = m_archetypes[a].chunks;
+
+		for (std::size_t c = 0; c < chunks.size(); c++) {
+			for (std::size_t row = 0; row < chunks[c].count; row++) {
+				DestroyRow(Location{
+					static_cast<int>(a),
+					static_cast<std::uint32_t>(c),
+					static_cast<std::uint32_t>(row)
+				});
+			}
+		}
+	}
+}
+
+TARCHETYPESTORAGE_TEMPLATE
+void TARCHETYPESTORAGE_DECL::Insert(std::size_t slot, const component_bitset& bitset)
+{
+	AllocateRow(FindOrCreateArchetype(bitset), slot);
+}
+
+TARCHETYPESTORAGE_TEMPLATE
+void TARCHETYPESTORAGE_DECL::Reserve(const component_bitset& bitset, std::size_t slotCount, std::size_t count)
+{
+	if (m_locations.size() < slotCount)
+		m_locations.resize(slotCount);
+
+	// Chunks themselves are still allocated as rows are, as only the last chunk may be partially filled
+	Archetype& arch = m_archetypes[FindOrCreateArchetype(bitset)];
+	const std::size_t rows = arch.chunks.empty() ? 0 : (arch.chunks.size() - 1) * arch.capacity + arch.chunks.back().count;
+	arch.chunks.reserve((rows + count + arch.capacity - 1) / arch.capacity);
+}
+
+TARCHETYPESTORAGE_TEMPLATE
+template<typename C, typename... Args>
+C& TARCHETYPESTORAGE_DECL::Emplace(std::size_t slot, Args&&... args)
+{
+	const Location& loc = m_locations[slot];
+	Archetype& arch = m_archetypes[loc.archetype];
+
+	assert(Entity::template HasComponent<C>(arch.bitset));
+	C* com = GetColumn<C>(arch, arch.chunks[loc.chunk]) + loc.row;
+
+	return *new (com) C(std::forward<Args>(args)...);
+}
+
+TARCHETYPESTORAGE_TEMPLATE
+template<typename C, typename... Args>
+C& TARCHETYPESTORAGE_DECL::Add(std::size_t slot, const component_bitset& bitset, Args&&... args)
+{
+	const Location from = m_locations[slot];
+	assert(m_archetypes[from.archetype].bitset == bitset); (void)bitset;
+
+	const int target = GetEdge<C>(from.archetype, true);
+	const Location to = AllocateRow(target, slot);
+
+	Archetype& arch = m_archetypes[target];
+	C* com = new (GetColumn<C>(arch, arch.chunks[to.chunk]) + to.row) C(std::forward<Args>(args)...);
+
+	MoveRow(from, to);
+	FreeRow(from);
+
+	return *com;
+}
+
+TARCHETYPESTORAGE_TEMPLATE
+template<typename C>
+C& TARCHETYPESTORAGE_DECL::Get(std::size_t slot)
+{
+	const Location& loc = m_locations[slot];
+	Archetype& arch = m_archetypes[loc.archetype];
+
+	assert(Entity::template HasComponent<C>(arch.bitset));
+	return GetColumn<C>(arch, arch.chunks[loc.chunk])[loc.row];
+}
+
+TARCHETYPESTORAGE_TEMPLATE
+template<typename C>
+void TARCHETYPESTORAGE_DECL::Remove(std::size_t slot, const component_bitset& bitset)
+{
+	const Location from = m_locations[slot];
+	assert(m_archetypes[from.archetype].bitset == component_bitset(bitset).set(CL::template indexOf<C>())); (void)bitset;
+
+	const int target = GetEdge<C>(from.archetype, false);
+	const Location to = AllocateRow(target, slot);
+
+	MoveRow(from, to);
+	FreeRow(from);
+}
+
+TARCHETYPESTORAGE_TEMPLATE
+void TARCHETYPESTORAGE_DECL::Erase(std::size_t slot, const component_bitset& bitset)
+{
+	const Location loc = m_locations[slot];
+	assert(m_archetypes[loc.archetype].bitset == bitset); (void)bitset;
+
+	DestroyRow(loc);
+	FreeRow(loc);
+
+	m_locations[slot].archetype = -1;
+}
+
+TARCHETYPESTORAGE_TEMPLATE
+void TARCHETYPESTORAGE_DECL::Compact()
+{
+	for (Archetype& arch : m_archetypes) {
+		arch.chunks.shrink_to_fit();
+	}
+}
+
+TARCHETYPESTORAGE_TEMPLATE
+template<typename C, typename F>
+void TARCHETYPESTORAGE_DECL::ForEachArray(F fun)
+{
+	for (Archetype& arch : m_archetypes) {
+		if (!Entity::template HasComponent<C>(arch.bitset))
+			continue;
+
+		for (Chunk& chunk : arch.chunks) {
+			fun(static_cast<const std::uint32_t*>(GetSlots(chunk)), GetColumn<C>(arch, chunk), chunk.count);
+		}
+	}
+}
+
+TARCHETYPESTORAGE_TEMPLATE
+template<typename C>
+ComponentStats TARCHETYPESTORAGE_DECL::GetStats() const
+{
+	ComponentStats stats;
+	stats.indexSize = m_locations.size();
+
+	for (const Archetype& arch : m_archetypes) {
+		if (!Entity::template HasComponent<C>(arch.bitset))
+			continue;
+
+		for (const Chunk& chunk : arch.chunks) {
+			stats.live += chunk.count;
+		}
+		stats.capacity += arch.chunks.size() * arch.capacity;
+	}
+
+	stats.bytes = stats.capacity * sizeof(C);
+	return stats;
+}
+
+TARCHETYPESTORAGE_TEMPLATE
+std::size_t TARCHETYPESTORAGE_DECL::GetSharedBytes() const
+{
+	std::size_t bytes = m_archetypes.capacity() * sizeof(Archetype)
+		+ m_archetypeMasks.capacity() * sizeof(component_bitset)
+		+ m_locations.capacity() * sizeof(Location);
+
+	for (const Archetype& arch : m_archetypes) {
+		// Slot column and alignment padding of every chunk
+		std::size_t componentBytes = 0;
+		TMP::ForEach<typename CL::types>([&](auto type_holder) {
+			(void)type_holder; using C = typename decltype(type_holder)::type;
+			if (Entity::template HasComponent<C>(arch.bitset))
+				componentBytes += arch.capacity * sizeof(C);
+		});
+
+		bytes += arch.chunks.capacity() * sizeof(Chunk) + arch.chunks.size() * (arch.chunkBytes - componentBytes);
+	}
+
+	return bytes;
+}
+
+TARCHETYPESTORAGE_TEMPLATE
+template<typename ...Cs, typename F>
+std::size_t TARCHETYPESTORAGE_DECL::ForEach(const std::vector<Entity>&, F fun)
+{
+	std::size_t scanned = 0;
+
+	constexpr component_bitset mask = Entity::template BitsetOf<Cs...>();
+
+	// Match the archetypes against the query a block at a time
+	const std::size_t blockSize = 64;
+	std::uint32_t matches[blockSize];
+
+	for (std::size_t base = 0; base < m_archetypeMasks.size(); base += blockSize) {
+		const std::size_t count = std::min(blockSize, m_archetypeMasks.size() - base);
+		const std::size_t matched = FilterContaining(&m_archetypeMasks[base], count, mask, matches);
+
+		for (std::size_t m = 0; m < matched; m++) {
+			Archetype& arch = m_archetypes[base + matches[m]];
+
+			for (Chunk& chunk : arch.chunks) {
+				const slot_type* slots = GetSlots(chunk);
+				std::tuple<Cs*...> columns(GetColumn<Cs>(arch, chunk)...);
+				(void)columns;
+
+				for (std::size_t row = 0; row < chunk.count; row++) {
+					fun(static_cast<std::size_t>(slots[row]), std::get<Cs*>(columns)[row]...);
+				}
+				scanned += chunk.count;
+			}
+		}
+	}
+
+	return scanned;
+}
+
+} // namespace Starbase
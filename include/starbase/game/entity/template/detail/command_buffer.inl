@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <algorithm>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace Starbase {
+
+#define TCOMMANDBUFFER_TEMPLATE \
+template<typename CL>
+
+#define TCOMMANDBUFFER_DECL \
+TCommandBuffer<CL>
+
+TCOMMANDBUFFER_TEMPLATE
+constexpr std::size_t TCOMMANDBUFFER_DECL::BLOCK_BYTES;
+
+TCOMMANDBUFFER_TEMPLATE
+TCOMMANDBUFFER_DECL::TCommandBuffer()
+	: m_block(0)
+	, m_offset(0)
+	, m_first(nullptr)
+	, m_last(nullptr)
+{}
+
+TCOMMANDBUFFER_TEMPLATE
+TCOMMANDBUFFER_DECL::~TCommandBuffer()
+{
+	Clear();
+}
+
+TCOMMANDBUFFER_TEMPLATE
+void* TCOMMANDBUFFER_DECL::Allocate(std::size_t size, std::size_t alignment)
+{
+	assert(alignment <= alignof(std::max_align_t));
+
+	while (true) {
+		if (m_block < m_blocks.size()) {
+			Block& block = m_blocks[m_block];
+			const std::size_t offset = (m_offset + alignment - 1) & ~(alignment - 1);
+
+			if (offset + size <= block.size) {
+				m_offset = offset + size;
+				return block.data.get() + offset;
+			}
+
+			m_block++;
+			m_offset = 0;
+			continue;
+		}
+
+		// Commands bigger than a block get a block of their own
+		const std::size_t blockSize = std::max(BLOCK_BYTES, size);
+		m_blocks.push_back(Block{ std::unique_ptr<unsigned char[]>(new unsigned char[blockSize]), blockSize });
+	}
+}
+
+TCOMMANDBUFFER_TEMPLATE
+template<typename T, typename... Args>
+T& TCOMMANDBUFFER_DECL::Record(Args&&... args)
+{
+	static_assert(std::is_base_of<Command, T>::value, "Commands must derive from Command");
+
+	return Append(new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...));
+}
+
+TCOMMANDBUFFER_TEMPLATE
+template<typename T, typename... Args>
+T& TCOMMANDBUFFER_DECL::RecordWithPayload(std::size_t payloadBytes, Args&&... args)
+{
+	static_assert(std::is_base_of<Command, T>::value, "Commands must derive from Command");
+
+	// Aligned for any component, so the payload is too
+	void* data = Allocate(PayloadOffset<T>() + payloadBytes, alignof(std::max_align_t));
+	return Append(new (data) T(std::forward<Args>(args)...));
+}
+
+TCOMMANDBUFFER_TEMPLATE
+template<typename T>
+unsigned char* TCOMMANDBUFFER_DECL::PayloadOf(T& command)
+{
+	return reinterpret_cast<unsigned char*>(&command) + PayloadOffset<T>();
+}
+
+TCOMMANDBUFFER_TEMPLATE
+template<typename T>
+T& TCOMMANDBUFFER_DECL::Append(T* command)
+{
+	command->next = nullptr;
+
+	if (m_last)
+		m_last->next = command;
+	else
+		m_first = command;
+	m_last = command;
+
+	return *command;
+}
+
+TCOMMANDBUFFER_TEMPLATE
+std::size_t TCOMMANDBUFFER_DECL::Size() const
+{
+	std::size_t count = 0;
+	for (const Command* command = m_first; command; command = command->next) {
+		count++;
+	}
+	return count;
+}
+
+TCOMMANDBUFFER_TEMPLATE
+std::size_t TCOMMANDBUFFER_DECL::BytesHeld() const
+{
+	std::size_t bytes = m_blocks.capacity() * sizeof(Block);
+	for (const Block& block : m_blocks) {
+		bytes += block.size;
+	}
+	return bytes;
+}
+
+TCOMMANDBUFFER_TEMPLATE
+template<typename F>
+void TCOMMANDBUFFER_DECL::ForEach(F fun)
+{
+	for (Command* command = m_first; command; command = command->next) {
+		fun(*command);
+	}
+}
+
+TCOMMANDBUFFER_TEMPLATE
+void TCOMMANDBUFFER_DECL::Play(TEntityManager<CL>& entityManager)
+{
+	// Commands recorded by event handlers during playback get appended, and
+	// are reached through the next pointers as well
+	Command* command = m_first;
+	while (command) {
+		command->play(entityManager, *command);
+
+		Command* next = command->next;
+		command->destroy(*command);
+		command = next;
+	}
+
+	m_first = m_last = nullptr;
+	m_block = 0;
+	m_offset = 0;
+}
+
+TCOMMANDBUFFER_TEMPLATE
+void TCOMMANDBUFFER_DECL::Clear()
+{
+	Command* command = m_first;
+	while (command) {
+		Command* next = command->next;
+		command->destroy(*command);
+		command = next;
+	}
+
+	m_first = m_last = nullptr;
+	m_block = 0;
+	m_offset = 0;
+}
+
+TCOMMANDBUFFER_TEMPLATE
+void TCOMMANDBUFFER_DECL::Trim()
+{
+	assert(Empty());
+
+	if (m_blocks.size() > 1) {
+		m_blocks.resize(1);
+		m_blocks.shrink_to_fit();
+	}
+}
+
+} // namespace Starbase
@@ -0,0 +1,118 @@
+#pragma once
+
+namespace Starbase {
+
+#define TCOMPONENTMASK_TEMPLATE \
+template<std::size_t N>
+
+#define TCOMPONENTMASK_DECL \
+TComponentMask<N>
+
+TCOMPONENTMASK_TEMPLATE
+constexpr std::size_t TCOMPONENTMASK_DECL::WORD_BITS;
+
+TCOMPONENTMASK_TEMPLATE
+constexpr std::size_t TCOMPONENTMASK_DECL::WORDS;
+
+TCOMPONENTMASK_TEMPLATE
+constexpr bool TCOMPONENTMASK_DECL::test(std::size_t index) const
+{
+	return (m_words[index / WORD_BITS] >> (index % WORD_BITS)) & 1;
+}
+
+TCOMPONENTMASK_TEMPLATE
+constexpr auto TCOMPONENTMASK_DECL::set(std::size_t index, bool value) -> TComponentMask&
+{
+	const word_type bit = word_type(1) << (index % WORD_BITS);
+	word_type& word = m_words[index / WORD_BITS];
+
+	word = value ? (word | bit) : (word & ~bit);
+	return *this;
+}
+
+TCOMPONENTMASK_TEMPLATE
+constexpr auto TCOMPONENTMASK_DECL::reset() -> TComponentMask&
+{
+	for (std::size_t i = 0; i < WORDS; i++)
+		m_words[i] = 0;
+	return *this;
+}
+
+TCOMPONENTMASK_TEMPLATE
+constexpr bool TCOMPONENTMASK_DECL::any() const
+{
+	word_type acc = 0;
+	for (std::size_t i = 0; i < WORDS; i++)
+		acc |= m_words[i];
+	return acc != 0;
+}
+
+TCOMPONENTMASK_TEMPLATE
+std::size_t TCOMPONENTMASK_DECL::count() const
+{
+	std::size_t result = 0;
+	for (std::size_t i = 0; i < WORDS; i++) {
+		word_type word = m_words[i];
+		for (; word; word &= word - 1)
+			result++;
+	}
+	return result;
+}
+
+TCOMPONENTMASK_TEMPLATE
+constexpr bool TCOMPONENTMASK_DECL::contains(const TComponentMask& mask) const
+{
+	// Accumulate the missing bits of all words instead of returning early
+	word_type missing = 0;
+	for (std::size_t i = 0; i < WORDS; i++)
+		missing |= mask.m_words[i] & ~m_words[i];
+	return missing == 0;
+}
+
+TCOMPONENTMASK_TEMPLATE
+constexpr auto TCOMPONENTMASK_DECL::operator&=(const TComponentMask& other) -> TComponentMask&
+{
+	for (std::size_t i = 0; i < WORDS; i++)
+		m_words[i] &= other.m_words[i];
+	return *this;
+}
+
+TCOMPONENTMASK_TEMPLATE
+constexpr auto TCOMPONENTMASK_DECL::operator|=(const TComponentMask& other) -> TComponentMask&
+{
+	for (std::size_t i = 0; i < WORDS; i++)
+		m_words[i] |= other.m_words[i];
+	return *this;
+}
+
+TCOMPONENTMASK_TEMPLATE
+constexpr bool TCOMPONENTMASK_DECL::operator==(const TComponentMask& other) const
+{
+	word_type diff = 0;
+	for (std::size_t i = 0; i < WORDS; i++)
+		diff |= m_words[i] ^ other.m_words[i];
+	return diff == 0;
+}
+
+TCOMPONENTMASK_TEMPLATE
+std::size_t TCOMPONENTMASK_DECL::hash() const
+{
+	std::size_t result = 0;
+	for (std::size_t i = 0; i < WORDS; i++)
+		result = result * 31 + std::hash<word_type>()(m_words[i]);
+	return result;
+}
+
+TCOMPONENTMASK_TEMPLATE
+std::size_t FilterContaining(const TComponentMask<N>* masks, std::size_t count, const TComponentMask<N>& mask, std::uint32_t* matches)
+{
+	// Always store, and only advance on a match, so the loop has no branches
+	std::size_t matched = 0;
+	for (std::size_t i = 0; i < count; i++) {
+		matches[matched] = static_cast<std::uint32_t>(i);
+		matched += masks[i].contains(mask);
+	}
+	return matched;
+}
+
+} // namespace Starbase
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cassert>
+#include <algorithm>
+#include <new>
+#include <utility>
+
+namespace Starbase {
+
+#define TCOMPONENTPOOL_TEMPLATE \
+template<typename C>
+
+#define TCOMPONENTPOOL_DECL \
+TComponentPool<C>
+
+TCOMPONENTPOOL_TEMPLATE
+constexpr std::int32_t TCOMPONENTPOOL_DECL::npos;
+
+TCOMPONENTPOOL_TEMPLATE
+bool TCOMPONENTPOOL_DECL::Contains(std::size_t slot) const
+{
+	return slot < m_sparse.size() && m_sparse[slot] != npos;
+}
+
+TCOMPONENTPOOL_TEMPLATE
+template<typename... Args>
+C& TCOMPONENTPOOL_DECL::Add(std::size_t slot, Args&&... args)
+{
+	assert(!Contains(slot));
+
+	if (m_sparse.size() <= slot)
+		m_sparse.resize(slot + 1, npos);
+
+	m_sparse[slot] = static_cast<std::int32_t>(m_dense.size());
+	m_slots.push_back(static_cast<std::uint32_t>(slot));
+	m_dense.emplace_back(C(std::forward<Args>(args)...));
+
+	return m_dense.back();
+}
+
+TCOMPONENTPOOL_TEMPLATE
+C& TCOMPONENTPOOL_DECL::Get(std::size_t slot)
+{
+	assert(Contains(slot));
+	return m_dense[m_sparse[slot]];
+}
+
+TCOMPONENTPOOL_TEMPLATE
+void TCOMPONENTPOOL_DECL::Remove(std::size_t slot)
+{
+	assert(Contains(slot));
+
+	const std::size_t index = static_cast<std::size_t>(m_sparse[slot]);
+	const std::size_t last = m_dense.size() - 1;
+
+	if (index != last) {
+		// Don't fill the hole by move-assignment!; that causes unique_ptr destructors
+		// to be called in the wrong order
+		C& com = m_dense[index];
+		(&com)->~C();
+		new (&com) C(std::move(m_dense[last]));
+
+		m_slots[index] = m_slots[last];
+		m_sparse[m_slots[index]] = static_cast<std::int32_t>(index);
+	}
+
+	m_dense.pop_back();
+	m_slots.pop_back();
+	m_sparse[slot] = npos;
+}
+
+TCOMPONENTPOOL_TEMPLATE
+void TCOMPONENTPOOL_DECL::Reserve(std::size_t slotCount, std::size_t count)
+{
+	if (m_sparse.size() < slotCount)
+		m_sparse.resize(slotCount, npos);
+
+	// Keep growing geometrically, so a series of small batches doesn't reallocate every time
+	const std::size_t size = m_dense.size() + count;
+	if (m_dense.capacity() < size) {
+		const std::size_t capacity = std::max(size, m_dense.capacity() * 2);
+		m_dense.reserve(capacity);
+		m_slots.reserve(capacity);
+	}
+}
+
+TCOMPONENTPOOL_TEMPLATE
+void TCOMPONENTPOOL_DECL::Compact()
+{
+	// Removals shuffle the dense array; in slot order, joins with other pools walk memory forward
+	std::vector<std::uint32_t> slots(m_slots);
+	std::sort(slots.begin(), slots.end());
+
+	std::vector<C> dense;
+	dense.reserve(slots.size());
+	for (std::size_t i = 0; i < slots.size(); i++) {
+		dense.emplace_back(std::move(m_dense[m_sparse[slots[i]]]));
+		m_sparse[slots[i]] = static_cast<std::int32_t>(i);
+	}
+
+	m_dense.swap(dense);
+	m_slots.swap(slots);
+
+	m_sparse.resize(m_slots.empty() ? 0 : m_slots.back() + 1);
+	m_sparse.shrink_to_fit();
+}
+
+TCOMPONENTPOOL_TEMPLATE
+ComponentStats TCOMPONENTPOOL_DECL::GetStats() const
+{
+	ComponentStats stats;
+	stats.live = m_dense.size();
+	stats.capacity = m_dense.capacity();
+	stats.indexSize = m_sparse.size();
+	stats.bytes = m_dense.capacity() * sizeof(C)
+		+ m_slots.capacity() * sizeof(std::uint32_t)
+		+ m_sparse.capacity() * sizeof(std::int32_t);
+	return stats;
+}
+
+} // namespace Starbase
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <initializer_list>
+
 #include "tmp.hpp"
 
 namespace Starbase {
@@ -10,11 +12,25 @@ template<typename CL>
 #define TENTITY_DECL \
 TEntity<CL>
 
+TENTITY_TEMPLATE
+TENTITY_DECL::TEntity(entity_id id, TEntityManager<CL>& entityManager)
+	: id(id)
+	, alive(true)
+	, isnew(true)
+	, manager(entityManager.m_slot)
+{}
+
+TENTITY_TEMPLATE
+TEntityManager<CL>& TENTITY_DECL::GetManager() const
+{
+	return TEntityManager<CL>::FromSlot(manager);
+}
+
 TENTITY_TEMPLATE
 template<typename C>
 void TENTITY_DECL::SetBit(component_bitset& bitset, bool val)
 {
-	bitset[CL::template indexOf<C>()] = val;
+	bitset.set(CL::template indexOf<C>(), val);
 }
 
 TENTITY_TEMPLATE
@@ -24,6 +40,15 @@ void TENTITY_DECL::SetBit(bool val)
 	SetBit<C>(bitset, val);
 }
 
+TENTITY_TEMPLATE
+template<typename ...Cs>
+constexpr auto TENTITY_DECL::BitsetOf() -> component_bitset
+{
+	component_bitset bitset;
+	(void)std::initializer_list<int>{ ((void)bitset.set(CL::template indexOf<Cs>()), 0)... };
+	return bitset;
+}
+
 TENTITY_TEMPLATE
 template<typename C>
 bool TENTITY_DECL::HasComponent(const component_bitset& bitset)
@@ -35,7 +60,8 @@ TENTITY_TEMPLATE
 template<typename ...Cs>
 bool TENTITY_DECL::HasComponents(const component_bitset& bitset)
 {
-	return TMP::And(HasComponent<Cs>(bitset)...);
+	constexpr component_bitset mask = BitsetOf<Cs...>();
+	return bitset.contains(mask);
 }
 
 TENTITY_TEMPLATE
@@ -49,14 +75,14 @@ TENTITY_TEMPLATE
 template<typename ...Cs>
 bool TENTITY_DECL::HasComponents() const
 {
-	return TMP::And(HasComponent<Cs>()...);
+	return HasComponents<Cs...>(bitset);
 }
 
 TENTITY_TEMPLATE
 template<typename C>
 C& TENTITY_DECL::GetComponent() const
 {
-	return entityManager->template GetComponent<C>(*this);
+	return GetManager().template GetComponent<C>(*this);
 }
 
 TENTITY_TEMPLATE
@@ -66,18 +92,25 @@ C* TENTITY_DECL::GetComponentOrNull() const
 	return HasComponent<C>() ? &GetComponent<C>() : nullptr;
 }
 
+TENTITY_TEMPLATE
+template<typename ...Cs>
+void TENTITY_DECL::MarkChanged() const
+{
+	GetManager().template MarkChanged<Cs...>(*this);
+}
+
 TENTITY_TEMPLATE
 template<typename C, typename... Args>
 C& TENTITY_DECL::AddComponent(Args&&... args)
 {
-    return entityManager->template AddComponent<C>(*this, std::forward<Args>(args)...);
+    return GetManager().template AddComponent<C>(*this, std::forward<Args>(args)...);
 }
 
 TENTITY_TEMPLATE
 template<typename C>
 void TENTITY_DECL::RemoveComponent()
 {
-    return entityManager->template RemoveComponent<C>(*this);
+    return GetManager().template RemoveComponent<C>(*this);
 }
 
 template<typename CL>
@@ -86,7 +119,6 @@ static bool operator==(const TEntity<CL>& a, const TEntity<CL>& b)
 	return a.id == b.id
 		&& a.bitset == b.bitset
 		&& a.alive == b.alive
-		&& a.needsToDie == b.needsToDie
 		&& a.isnew == b.isnew;
 }
 
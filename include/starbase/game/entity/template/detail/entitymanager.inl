@@ -1,9 +1,18 @@
 #pragma once
 
+#include <cassert>
 #include <cstddef>
+#include <cstdlib>
+#include <cstring>
 #include <limits>
+#include <new>
+#include <initializer_list>
 #include <algorithm>
+#include <array>
 #include <functional>
+#include <sstream>
+#include <thread>
+#include <type_traits>
 
 #include <starbase/game/logging.hpp>
 
@@ -17,183 +26,902 @@ template<typename CL>
 #define TENTITYMANAGER_DECL \
 TEntityManager<CL>
 
+TENTITYMANAGER_TEMPLATE
+constexpr int TENTITYMANAGER_DECL::FIND_ENTITY;
+
+TENTITYMANAGER_TEMPLATE
+constexpr std::uint32_t TENTITYMANAGER_DECL::SNAPSHOT_MAGIC;
+
+TENTITYMANAGER_TEMPLATE
+constexpr std::uint32_t TENTITYMANAGER_DECL::SNAPSHOT_VERSION;
+
+TENTITYMANAGER_TEMPLATE
+std::atomic<std::uint64_t> TENTITYMANAGER_DECL::s_serialCounter(0);
+
+TENTITYMANAGER_TEMPLATE
+thread_local typename TENTITYMANAGER_DECL::CommandBufferCache TENTITYMANAGER_DECL::t_commandBuffer = { 0, nullptr };
+
+TENTITYMANAGER_TEMPLATE
+constexpr std::size_t TENTITYMANAGER_DECL::MAX_MANAGERS;
+
+TENTITYMANAGER_TEMPLATE
+std::array<std::atomic<TEntityManager<CL>*>, TENTITYMANAGER_DECL::MAX_MANAGERS> TENTITYMANAGER_DECL::s_managers{};
+
+TENTITYMANAGER_TEMPLATE
+template<typename ...Cs>
+struct TENTITYMANAGER_DECL::CreateCommand : Command {
+	Entity entity;
+	std::tuple<Cs...> components;
+
+	template<typename... Args>
+	CreateCommand(entity_id id, TEntityManager& entityManager, Args&&... args)
+		: entity(id, entityManager)
+		, components(std::forward<Args>(args)...)
+	{
+		this->play = &Play;
+		this->destroy = &Destroy;
+		this->find = &Find;
+		this->id = id;
+
+		entity.bitset = Entity::template BitsetOf<Cs...>();
+	}
+
+	static void Play(TEntityManager& entityManager, Command& command)
+	{ entityManager.PlayCreate(static_cast<CreateCommand&>(command)); }
+
+	static void Destroy(Command& command)
+	{ static_cast<CreateCommand&>(command).~CreateCommand(); }
+
+	static void* Find(Command& command, int index)
+	{
+		CreateCommand& create = static_cast<CreateCommand&>(command);
+		void* result = index == FIND_ENTITY ? &create.entity : nullptr;
+		(void)std::initializer_list<int>{
+			(index == CL::template indexOf<Cs>() ? ((void)(result = &std::get<Cs>(create.components)), 0) : 0)...
+		};
+		return result;
+	}
+};
+
+TENTITYMANAGER_TEMPLATE
+template<typename ...Cs>
+struct TENTITYMANAGER_DECL::CreateBatchCommand : Command {
+	std::vector<std::tuple<Cs...>> components;
+
+	CreateBatchCommand(entity_id first, std::size_t count)
+		: components(count)
+	{
+		this->play = &Play;
+		this->destroy = &Destroy;
+		this->find = &Find;
+		this->id = first;
+	}
+
+	static void Play(TEntityManager& entityManager, Command& command)
+	{ entityManager.PlayCreateBatch(static_cast<CreateBatchCommand&>(command)); }
+
+	static void Destroy(Command& command)
+	{ static_cast<CreateBatchCommand&>(command).~CreateBatchCommand(); }
+
+	// Entities of a batch cannot be accessed before they are played back
+	static void* Find(Command&, int)
+	{ return nullptr; }
+};
+
+TENTITYMANAGER_TEMPLATE
+struct TENTITYMANAGER_DECL::InstantiateCommand : Command {
+	using offset_array = std::array<std::uint32_t, CL::count>;
+
+	Entity entity;
+
+	// Components to create, kept apart from entity.bitset, which AddComponent
+	// and RemoveComponent change before playback
+	component_bitset bitset;
+
+	// Of the components in bitset, packed in the payload of the command
+	offset_array offsets;
+
+	// Lays out the components of bitset, and returns the payload size
+	static std::size_t Layout(const component_bitset& bitset, offset_array& offsets)
+	{
+		std::size_t size = 0;
+		TMP::ForEach<typename CL::types>([&](auto type_holder) {
+			(void)type_holder; using C = typename decltype(type_holder)::type;
+
+			if (Entity::template HasComponent<C>(bitset)) {
+				size = (size + alignof(C) - 1) & ~(alignof(C) - 1);
+				offsets[CL::template indexOf<C>()] = static_cast<std::uint32_t>(size);
+				size += sizeof(C);
+			}
+		});
+		return size;
+	}
+
+	// Copies the components of the prefab, and default constructs the others of bitset
+	InstantiateCommand(entity_id id, TEntityManager& entityManager, const TPrefab<CL>& prefab, const component_bitset& bitset, const offset_array& offsets)
+		: entity(id, entityManager)
+		, bitset(bitset)
+		, offsets(offsets)
+	{
+		this->play = &Play;
+		this->destroy = &Destroy;
+		this->find = &Find;
+		this->id = id;
+
+		entity.bitset = bitset;
+
+		TMP::ForEach<typename CL::types>([&](auto type_holder) {
+			(void)type_holder; using C = typename decltype(type_holder)::type;
+
+			if (Entity::template HasComponent<C>(bitset)) {
+				if (prefab.template Has<C>())
+					new (Address<C>()) C(prefab.template Get<C>());
+				else
+					new (Address<C>()) C();
+			}
+		});
+	}
+
+	~InstantiateCommand()
+	{
+		TMP::ForEach<typename CL::types>([&](auto type_holder) {
+			(void)type_holder; using C = typename decltype(type_holder)::type;
+
+			if (Entity::template HasComponent<C>(bitset))
+				Get<C>().~C();
+		});
+	}
+
+	template<typename C>
+	void* Address()
+	{ return CommandBuffer::PayloadOf(*this) + offsets[CL::template indexOf<C>()]; }
+
+	// Only for components in bitset
+	template<typename C>
+	C& Get()
+	{ return *static_cast<C*>(Address<C>()); }
+
+	static void Play(TEntityManager& entityManager, Command& command)
+	{ entityManager.PlayInstantiate(static_cast<InstantiateCommand&>(command)); }
+
+	static void Destroy(Command& command)
+	{ static_cast<InstantiateCommand&>(command).~InstantiateCommand(); }
+
+	static void* Find(Command& command, int index)
+	{
+		InstantiateCommand& instantiate = static_cast<InstantiateCommand&>(command);
+		if (index == FIND_ENTITY)
+			return &instantiate.entity;
+
+		void* result = nullptr;
+		TMP::ForEach<typename CL::types>([&](auto type_holder) {
+			(void)type_holder; using C = typename decltype(type_holder)::type;
+
+			if (index == CL::template indexOf<C>() && Entity::template HasComponent<C>(instantiate.bitset))
+				result = instantiate.template Address<C>();
+		});
+		return result;
+	}
+};
+
+TENTITYMANAGER_TEMPLATE
+template<typename C>
+struct TENTITYMANAGER_DECL::AddCommand : Command {
+	C component;
+
+	template<typename... Args>
+	AddCommand(entity_id id, Args&&... args)
+		: component(std::forward<Args>(args)...)
+	{
+		this->play = &Play;
+		this->destroy = &Destroy;
+		this->find = &Find;
+		this->id = id;
+	}
+
+	static void Play(TEntityManager& entityManager, Command& command)
+	{ entityManager.PlayAdd(static_cast<AddCommand&>(command)); }
+
+	static void Destroy(Command& command)
+	{ static_cast<AddCommand&>(command).~AddCommand(); }
+
+	static void* Find(Command& command, int index)
+	{ return index == CL::template indexOf<C>() ? &static_cast<AddCommand&>(command).component : nullptr; }
+};
+
+TENTITYMANAGER_TEMPLATE
+template<typename C>
+struct TENTITYMANAGER_DECL::RemoveCommand : Command {
+	explicit RemoveCommand(entity_id id)
+	{
+		this->play = &Play;
+		this->destroy = &Destroy;
+		this->find = &Find;
+		this->id = id;
+	}
+
+	static void Play(TEntityManager& entityManager, Command& command)
+	{ entityManager.PlayRemove(static_cast<RemoveCommand&>(command)); }
+
+	static void Destroy(Command&)
+	{}
+
+	static void* Find(Command&, int)
+	{ return nullptr; }
+};
+
+TENTITYMANAGER_TEMPLATE
+struct TENTITYMANAGER_DECL::DestroyCommand : Command {
+	explicit DestroyCommand(entity_id id)
+	{
+		this->play = &Play;
+		this->destroy = &Destroy;
+		this->find = &Find;
+		this->id = id;
+	}
+
+	static void Play(TEntityManager& entityManager, Command& command)
+	{ entityManager.PlayDestroy(static_cast<DestroyCommand&>(command)); }
+
+	static void Destroy(Command&)
+	{}
+
+	static void* Find(Command&, int)
+	{ return nullptr; }
+};
+
+#ifndef NDEBUG
+TENTITYMANAGER_TEMPLATE
+thread_local const typename TENTITYMANAGER_DECL::component_bitset* TENTITYMANAGER_DECL::t_parallelWrites = nullptr;
+#endif
+
+TENTITYMANAGER_TEMPLATE
+TENTITYMANAGER_DECL::ParallelLoopScope::ParallelLoopScope(const component_bitset& writes)
+{
+#ifndef NDEBUG
+	m_previous = t_parallelWrites;
+	t_parallelWrites = &writes;
+#else
+	(void)writes;
+	m_previous = nullptr;
+#endif
+}
+
+TENTITYMANAGER_TEMPLATE
+TENTITYMANAGER_DECL::ParallelLoopScope::~ParallelLoopScope()
+{
+#ifndef NDEBUG
+	t_parallelWrites = m_previous;
+#endif
+}
+
+TENTITYMANAGER_TEMPLATE
+bool TENTITYMANAGER_DECL::InParallelLoop()
+{
+#ifndef NDEBUG
+	return t_parallelWrites != nullptr;
+#else
+	return false;
+#endif
+}
+
+TENTITYMANAGER_TEMPLATE
+template<typename ...Cs>
+auto TENTITYMANAGER_DECL::MutableBitsetOf() -> component_bitset
+{
+	component_bitset bitset;
+	(void)std::initializer_list<int>{
+		(std::is_const<Cs>::value ? 0 : ((void)bitset.set(CL::template indexOf<std::remove_const_t<Cs>>()), 0))...
+	};
+	return bitset;
+}
+
+
 TENTITYMANAGER_TEMPLATE
 entity_id TENTITYMANAGER_DECL::GenerateId()
 {
-	return ++m_entityIdCounter;
+	std::lock_guard<std::mutex> lock(m_idMutex);
+
+	if (!m_entitiesFree.empty()) {
+		const std::uint32_t index = m_entitiesFree.back();
+		m_entitiesFree.pop_back();
+
+		return entity_id(index, m_generations[index]);
+	}
+
+	// m_generations is only grown by Update(), when the entity is played back
+	return entity_id(m_indexCount++, 1);
+}
+
+TENTITYMANAGER_TEMPLATE
+entity_id TENTITYMANAGER_DECL::GenerateIds(std::size_t count)
+{
+	// Always fresh indices, so the block is contiguous; the free list is left for single entities
+	std::lock_guard<std::mutex> lock(m_idMutex);
+
+	const std::uint32_t first = m_indexCount.fetch_add(static_cast<std::uint32_t>(count));
+	return entity_id(first, 1);
+}
+
+TENTITYMANAGER_TEMPLATE
+void TENTITYMANAGER_DECL::FreeId(entity_id id)
+{
+	std::uint32_t& generation = m_generations[id.index];
+	assert(generation == id.generation);
+
+	// skip 0 on wrap-around, as that is the invalid generation
+	if (SB_UNLIKELY(++generation == 0))
+		generation = 1;
+
+	std::lock_guard<std::mutex> lock(m_idMutex);
+	m_entitiesFree.push_back(id.index);
+}
+
+TENTITYMANAGER_TEMPLATE
+std::size_t TENTITYMANAGER_DECL::GetSlot(const Entity& ent) const
+{
+	return ent.id.index;
+}
+
+TENTITYMANAGER_TEMPLATE
+void TENTITYMANAGER_DECL::GrowSlots(std::size_t end)
+{
+	if (m_generations.size() < end)
+		m_generations.resize(end, 1);
+	if (m_entities.size() < end)
+		m_entities.resize(end);
+
+	for (std::vector<std::uint32_t>& versions : m_versions) {
+		if (versions.size() < end)
+			versions.resize(end, 0);
+	}
+}
+
+TENTITYMANAGER_TEMPLATE
+template<typename ...Cs>
+void TENTITYMANAGER_DECL::StampVersions(std::size_t slot)
+{
+	(void)std::initializer_list<int>{
+		((void)(m_versions[CL::template indexOf<Cs>()][slot] = m_tick), 0)...
+	};
+}
+
+TENTITYMANAGER_TEMPLATE
+auto TENTITYMANAGER_DECL::GetViewSet(const component_bitset& mask) -> const TViewSet<CL>&
+{
+	std::lock_guard<std::mutex> lock(m_viewsMutex);
+
+	for (const auto& view : m_views) {
+		if (view->GetMask() == mask)
+			return *view;
+	}
+
+	m_views.emplace_back(new TViewSet<CL>(mask));
+	TViewSet<CL>& view = *m_views.back();
+
+	for (const Entity& ent : m_entities) {
+		if (ent.alive)
+			view.Refresh(GetSlot(ent), ent.bitset);
+	}
+
+	return view;
+}
+
+TENTITYMANAGER_TEMPLATE
+void TENTITYMANAGER_DECL::RefreshViews(const Entity& ent)
+{
+	for (const auto& view : m_views) {
+		view->Refresh(GetSlot(ent), ent.bitset);
+	}
+}
+
+TENTITYMANAGER_TEMPLATE
+auto TENTITYMANAGER_DECL::GetCommandBuffer() -> CommandBuffer&
+{
+	if (SB_LIKELY(t_commandBuffer.serial == m_serial))
+		return *t_commandBuffer.buffer;
+
+	std::lock_guard<std::mutex> lock(m_commandBuffersMutex);
+
+	const std::thread::id threadId = std::this_thread::get_id();
+	auto iter = std::find_if(m_commandBuffers.begin(), m_commandBuffers.end(), [&](const auto& pair) {
+		return pair.first == threadId;
+	});
+
+	if (iter == m_commandBuffers.end()) {
+		m_commandBuffers.emplace_back(threadId, std::unique_ptr<CommandBuffer>(new CommandBuffer()));
+		iter = m_commandBuffers.end() - 1;
+	}
+
+	t_commandBuffer.serial = m_serial;
+	t_commandBuffer.buffer = iter->second.get();
+
+	return *iter->second;
+}
+
+TENTITYMANAGER_TEMPLATE
+void* TENTITYMANAGER_DECL::FindNew(entity_id id, int index)
+{
+	// The last command wins, as components may have been added after creation
+	void* result = nullptr;
+	GetCommandBuffer().ForEach([&](Command& command) {
+		if (command.id == id) {
+			if (void* found = command.find(command, index))
+				result = found;
+		}
+	});
+	return result;
+}
+
+TENTITYMANAGER_TEMPLATE
+auto TENTITYMANAGER_DECL::GetEntityExisting(entity_id id) -> Entity*
+{
+	if (IsValid(id) && id.index < m_entities.size() && m_entities[id.index].alive)
+		return &m_entities[id.index];
+
+	return nullptr;
+}
+
+TENTITYMANAGER_TEMPLATE
+template<typename ...Cs, typename... Args>
+auto TENTITYMANAGER_DECL::RecordCreate(Args&&... args) -> CreateCommand<Cs...>&
+{
+	const entity_id id = GenerateId();
+	return GetCommandBuffer().template Record<CreateCommand<Cs...>>(id, *this, std::forward<Args>(args)...);
+}
+
+TENTITYMANAGER_TEMPLATE
+template<typename ...Cs>
+void TENTITYMANAGER_DECL::PlayCreate(CreateCommand<Cs...>& command)
+{
+	// Move the entity to its reserved spot in the main vector
+	const std::size_t slot = command.id.index;
+	GrowSlots(slot + 1);
+
+	Entity& ent = m_entities[slot];
+	ent = Entity(command.id, *this);
+	ent.bitset = Entity::template BitsetOf<Cs...>();
+	ent.isnew = false;
+
+	// Do the same for its belonging components
+	m_storage.Insert(slot, ent.bitset);
+
+	(void)std::initializer_list<int>{
+		((void)m_storage.template Emplace<Cs>(slot, std::move(std::get<Cs>(command.components))), 0)...
+	};
+	StampVersions<Cs...>(slot);
+
+	RefreshViews(ent);
+
+	EmitEntityAdded(ent);
+}
+
+TENTITYMANAGER_TEMPLATE
+void TENTITYMANAGER_DECL::PlayInstantiate(InstantiateCommand& command)
+{
+	const std::size_t slot = command.id.index;
+	GrowSlots(slot + 1);
+
+	Entity& ent = m_entities[slot];
+	ent = Entity(command.id, *this);
+	ent.bitset = command.bitset;
+	ent.isnew = false;
+
+	m_storage.Insert(slot, ent.bitset);
+
+	TMP::ForEach<typename CL::types>([&](auto type_holder) {
+		(void)type_holder; using C = typename decltype(type_holder)::type;
+
+		if (ent.template HasComponent<C>()) {
+			m_storage.template Emplace<C>(slot, std::move(command.template Get<C>()));
+			StampVersions<C>(slot);
+		}
+	});
+
+	RefreshViews(ent);
+
+	EmitEntityAdded(ent);
+}
+
+TENTITYMANAGER_TEMPLATE
+void TENTITYMANAGER_DECL::EmitEntityAdded(Entity& ent)
+{
+	// Send signal
+	m_eventManager.template Emit<entity_added>(ent);
+
+	// Send component signals (only after they've all been added)
+	TMP::ForEach<typename CL::types>([&](auto type_holder) {
+		(void)type_holder; using C = typename decltype(type_holder)::type;
+
+		if (ent.template HasComponent<C>()) {
+			C& com = ent.template GetComponent<C>();
+
+			m_eventManager.template Emit<C, component_added>(ent, com);
+		}
+	});
+}
+
+TENTITYMANAGER_TEMPLATE
+template<typename ...Cs>
+void TENTITYMANAGER_DECL::PlayCreateBatch(CreateBatchCommand<Cs...>& command)
+{
+	const std::size_t first = command.id.index;
+	const std::size_t count = command.components.size();
+	const std::size_t end = first + count;
+
+	GrowSlots(end);
+
+	const component_bitset bitset = Entity::template BitsetOf<Cs...>();
+
+	// Grow the storage once for the whole batch, instead of entity by entity
+	m_storage.Reserve(bitset, end, count);
+
+	for (std::size_t i = 0; i < count; i++) {
+		const std::size_t slot = first + i;
+
+		Entity& ent = m_entities[slot];
+		ent = Entity(entity_id(static_cast<std::uint32_t>(slot), 1), *this);
+		ent.bitset = bitset;
+		ent.isnew = false;
+
+		m_storage.Insert(slot, bitset);
+
+		std::tuple<Cs...>& components = command.components[i];
+		(void)std::initializer_list<int>{
+			((void)m_storage.template Emplace<Cs>(slot, std::move(std::get<Cs>(components))), 0)...
+		};
+		StampVersions<Cs...>(slot);
+
+		RefreshViews(ent);
+	}
+
+	// One signal for the whole batch, instead of entity_added and component_added per entity
+	if (count > 0)
+		m_eventManager.template Emit<entities_added>(&m_entities[first], count);
+}
+
+TENTITYMANAGER_TEMPLATE
+template<typename C>
+void TENTITYMANAGER_DECL::PlayAdd(AddCommand<C>& command)
+{
+	Entity* ent = GetEntityExisting(command.id);
+
+	if (SB_UNLIKELY(!ent)) {
+		LOG(warning) << "Entity " << command.id << " is gone, so cannot add component " << CL::template indexOf<C>();
+	}
+	else if (SB_UNLIKELY(ent->template HasComponent<C>())) {
+		LOG(warning) << "Entity " << command.id << " already has component " << CL::template indexOf<C>() << ", so cannot add!";
+	}
+	else {
+		C& com = AddComponentExistingImpl<C>(*ent, std::move(command.component));
+
+		m_eventManager.template Emit<C, component_added>(*ent, com);
+	}
 }
 
 TENTITYMANAGER_TEMPLATE
 template<typename C>
-std::vector<C>& TENTITYMANAGER_DECL::GetComponents()
+void TENTITYMANAGER_DECL::PlayRemove(RemoveCommand<C>& command)
+{
+	Entity* ent = GetEntityExisting(command.id);
+
+	if (SB_LIKELY(ent && ent->template HasComponent<C>())) {
+		C& comp = ent->template GetComponent<C>();
+
+		ent->template SetBit<C>(false); // do it before emitting the event
+		m_eventManager.template Emit<C, component_removed>(*ent, comp);
+
+		RemoveComponentExistingImpl<C>(*ent);
+	}
+	else {
+		LOG(warning) << "Entity " << command.id << " does not have component " << CL::template indexOf<C>() << ", so cannot remove!";
+	}
+}
+
+TENTITYMANAGER_TEMPLATE
+void TENTITYMANAGER_DECL::PlayDestroy(DestroyCommand& command)
 {
-	return std::get<std::vector<C>>(m_components);
+	// Put on the kill list; the entity may be created by a command buffer not played back yet
+	m_entitiesDestroyed.push_back(command.id);
 }
 
 TENTITYMANAGER_TEMPLATE
 template<typename C>
-std::map<entity_id, C>& TENTITYMANAGER_DECL::GetComponentsNew()
+void TENTITYMANAGER_DECL::SnapshotComponents(SnapshotWriter& writer)
 {
-	return std::get<std::map<entity_id, C>>(m_componentsNew);
+	const int index = CL::template indexOf<C>();
+	const Serializer& serializer = m_serializers[index];
+
+	std::uint32_t kind = SECTION_SKIPPED;
+	if (serializer.save)
+		kind = SECTION_SERIALIZED;
+	else if (std::is_trivially_copyable<C>::value)
+		kind = SECTION_RAW;
+
+	std::uint32_t count = 0;
+	if (SB_LIKELY(kind != SECTION_SKIPPED)) {
+		m_storage.template ForEachArray<C>([&](const std::uint32_t*, C*, std::size_t size) {
+			count += static_cast<std::uint32_t>(size);
+		});
+	}
+	else {
+		LOG(warning) << "Component " << index << " has no serializer, so it is left out of the snapshot";
+	}
+
+	writer.Write(kind);
+	writer.Write(static_cast<std::uint32_t>(sizeof(C)));
+	writer.Write(count);
+
+	// Size of the section data, filled in at the end
+	const std::size_t sizeOffset = writer.Size();
+	writer.Write(std::uint64_t(0));
+	const std::size_t start = writer.Size();
+
+	if (count == 0)
+		return;
+
+	// Slots first, so Restore() can set up the entities before constructing components
+	m_storage.template ForEachArray<C>([&](const std::uint32_t* slots, C*, std::size_t size) {
+		writer.WriteBytes(slots, size * sizeof(std::uint32_t));
+	});
+
+	if (kind == SECTION_RAW) {
+		m_storage.template ForEachArray<C>([&](const std::uint32_t*, C* components, std::size_t size) {
+			writer.WriteBytes(components, size * sizeof(C));
+		});
+	}
+	else {
+		m_storage.template ForEachArray<C>([&](const std::uint32_t*, C* components, std::size_t size) {
+			for (std::size_t i = 0; i < size; i++) {
+				serializer.save(&components[i], writer);
+			}
+		});
+	}
+
+	writer.WriteAt(sizeOffset, static_cast<std::uint64_t>(writer.Size() - start));
 }
 
 TENTITYMANAGER_TEMPLATE
 template<typename C>
-std::vector<C*>& TENTITYMANAGER_DECL::GetComponentsFree()
+bool TENTITYMANAGER_DECL::ScanComponents(SnapshotReader& reader, const std::vector<bool>& live, std::vector<component_bitset>& bitsets)
 {
-	return std::get<std::vector<C*>>(m_componentsFree);
+	const int index = CL::template indexOf<C>();
+
+	std::uint32_t kind = 0, size = 0, count = 0;
+	std::uint64_t bytes = 0;
+	reader.Read(kind);
+	reader.Read(size);
+	reader.Read(count);
+	reader.Read(bytes);
+
+	const unsigned char* data = reader.Skip(static_cast<std::size_t>(bytes));
+	if (!data)
+		return false;
+
+	const std::uint64_t slotBytes = std::uint64_t(count) * sizeof(std::uint32_t);
+	switch (kind) {
+	case SECTION_SKIPPED:
+		return count == 0;
+	case SECTION_RAW:
+		if (!std::is_trivially_copyable<C>::value || size != sizeof(C) || bytes != slotBytes + std::uint64_t(count) * sizeof(C))
+			return false;
+		break;
+	case SECTION_SERIALIZED:
+		if (!m_serializers[index].load) {
+			LOG(error) << "No serializer registered to load component " << index << " from the snapshot";
+			return false;
+		}
+		if (bytes < slotBytes)
+			return false;
+		break;
+	default:
+		return false;
+	}
+
+	for (std::uint32_t i = 0; i < count; i++) {
+		std::uint32_t slot;
+		std::memcpy(&slot, data + i * sizeof(std::uint32_t), sizeof(slot));
+
+		if (slot >= live.size() || !live[slot] || bitsets[slot][index])
+			return false;
+
+		bitsets[slot].set(index);
+	}
+
+	return true;
 }
 
 TENTITYMANAGER_TEMPLATE
 template<typename C>
-std::unordered_map<entity_id, int>& TENTITYMANAGER_DECL::GetComponentsIndex()
+bool TENTITYMANAGER_DECL::RestoreComponents(SnapshotReader& reader)
 {
-	return m_componentsIndex[CL::template indexOf<C>()];
+	// Only called on sections validated by ScanComponents()
+	std::uint32_t kind = 0, size = 0, count = 0;
+	std::uint64_t bytes = 0;
+	reader.Read(kind);
+	reader.Read(size);
+	reader.Read(count);
+	reader.Read(bytes);
+
+	const unsigned char* slots = reader.Skip(static_cast<std::size_t>(bytes));
+	const unsigned char* data = slots + count * sizeof(std::uint32_t);
+	const std::size_t dataBytes = static_cast<std::size_t>(bytes) - count * sizeof(std::uint32_t);
+
+	SnapshotReader records(data, dataBytes);
+
+	for (std::uint32_t i = 0; i < count; i++) {
+		std::uint32_t slot;
+		std::memcpy(&slot, slots + i * sizeof(std::uint32_t), sizeof(slot));
+
+		C& com = m_storage.template Emplace<C>(slot);
+		StampVersions<C>(slot);
+
+		if (kind == SECTION_RAW)
+			std::memcpy(static_cast<void*>(&com), data + i * sizeof(C), sizeof(C));
+		else
+			m_serializers[CL::template indexOf<C>()].load(records, &com);
+	}
+
+	return !records.Failed();
 }
 
 TENTITYMANAGER_TEMPLATE
 template<typename C>
-C& TENTITYMANAGER_DECL::GetComponentExistingImpl(entity_id id)
+C& TENTITYMANAGER_DECL::GetComponentExistingImpl(const Entity& ent)
 {
-	auto& components = GetComponents<C>();
-	auto& componentsIndex = GetComponentsIndex<C>();
-
-	assert(componentsIndex.count(id));
-	return components.at(componentsIndex.at(id));
+	return m_storage.template Get<C>(GetSlot(ent));
 }
 
 TENTITYMANAGER_TEMPLATE
 template<typename C>
 C& TENTITYMANAGER_DECL::GetComponentNewImpl(entity_id id)
 {
-	auto& componentsNew = GetComponentsNew<C>();
+	void* com = FindNew(id, CL::template indexOf<C>());
 
-	assert(componentsNew.count(id));
-	return componentsNew.at(id);
+	assert(com && "New entities can only be accessed from the thread that created them!");
+	return *static_cast<C*>(com);
 }
 
 TENTITYMANAGER_TEMPLATE
 template<typename C, typename... Args>
 C& TENTITYMANAGER_DECL::AddComponentExistingImpl(Entity& ent, Args&&... args)
 {
-	auto& components = GetComponents<C>();
-	auto& componentsIndex = GetComponentsIndex<C>();
-
-	components.emplace_back(C(std::forward<Args>(args)...));
-
-	C& com = components.back();
-	componentsIndex[ent.id] = static_cast<int>(components.size() - 1);
+	C& com = m_storage.template Add<C>(GetSlot(ent), ent.bitset, std::forward<Args>(args)...);
+	StampVersions<C>(GetSlot(ent));
 
 	ent.template SetBit<C>(true);
+	RefreshViews(ent);
 
 	return com;
 }
 
 TENTITYMANAGER_TEMPLATE
-template<typename C, typename... Args>
-C& TENTITYMANAGER_DECL::AddComponentNewImpl(Entity& ent, Args&&... args)
+template<typename C>
+void TENTITYMANAGER_DECL::RemoveComponentExistingImpl(Entity& ent)
 {
-	auto& componentsNew = GetComponentsNew<C>();
-	C& com = componentsNew.emplace(ent.id, C(std::forward<Args>(args)...)).first->second;
+	ent.template SetBit<C>(false);
+	RefreshViews(ent);
 
-	ent.template SetBit<C>(true);
-	return com;
+	m_storage.template Remove<C>(GetSlot(ent), ent.bitset);
 }
 
 TENTITYMANAGER_TEMPLATE
-template<typename C>
-void TENTITYMANAGER_DECL::RemoveComponentNewImpl(Entity& ent)
+void TENTITYMANAGER_DECL::RemoveEntityExistingImpl(Entity& ent)
 {
-	auto& componentsNew = GetComponentsNew<C>();
-	componentsNew.erase(ent.id);
+	m_storage.Erase(GetSlot(ent), ent.bitset);
 
-	ent.template SetBit<C>(false);
+	ent.bitset.reset();
+	RefreshViews(ent);
+
+	FreeId(ent.id);
+
+	ent = Entity(); // clearing not necessary, but handy for debugging
+	ent.alive = false;
 }
 
 TENTITYMANAGER_TEMPLATE
-template<typename C>
-void TENTITYMANAGER_DECL::RemoveComponentExistingImpl(Entity& ent)
+TENTITYMANAGER_DECL::TEntityManager(TEventManagerBase<CL>& eventManager)
+	: m_indexCount(0)
+	, m_tick(1)
+	, m_serial(++s_serialCounter)
+	, m_slot(AcquireSlot(this))
+	, m_eventManager(eventManager)
+	, m_threadPool(nullptr)
 {
-	auto& components = GetComponents<C>();
-	auto& componentsFree = GetComponentsFree<C>();
-	auto& componentsIndex = GetComponentsIndex<C>();
-
-	C& com = components[componentsIndex[ent.id]];
-
-	// Clear component to free any relating handles immediately
-	// Don't clear by reassignment!; that causes unique_ptr destructors to be called
-	// in the wrong order
-	(&com)->~C();
-	new (&com) C{};
-
-	componentsFree.push_back(&com);
-    componentsIndex.erase(ent.id);
+	static_assert(CL::count <= MAX_COMPONENTS, "MAX_COMPONENTS size is unsufficient, raise STARBASE_MAX_COMPONENTS!");
+}
 
-	ent.template SetBit<C>(false);
+TENTITYMANAGER_TEMPLATE
+TENTITYMANAGER_DECL::~TEntityManager()
+{
+	s_managers[m_slot].store(nullptr, std::memory_order_release);
 }
 
 TENTITYMANAGER_TEMPLATE
-void TENTITYMANAGER_DECL::RemoveComponentsNew(Entity& ent)
+std::uint8_t TENTITYMANAGER_DECL::AcquireSlot(TEntityManager* entityManager)
 {
-	TMP::ForEach<typename CL::types>([&](auto type_holder) {
-		(void)type_holder; using C = typename decltype(type_holder)::type;
-		if (ent.template HasComponent<C>())
-            this->RemoveComponentNewImpl<C>(ent);
-	});
+	for (std::size_t slot = 0; slot < MAX_MANAGERS; slot++) {
+		TEntityManager* expected = nullptr;
+		if (s_managers[slot].compare_exchange_strong(expected, entityManager, std::memory_order_acq_rel))
+			return static_cast<std::uint8_t>(slot);
+	}
+
+	LOG(error) << "More than " << MAX_MANAGERS << " entity managers of the same components";
+	std::abort();
 }
 
 TENTITYMANAGER_TEMPLATE
-void TENTITYMANAGER_DECL::RemoveComponentsExisting(Entity& ent)
+auto TENTITYMANAGER_DECL::FromSlot(std::uint8_t slot) -> TEntityManager&
 {
-	TMP::ForEach<typename CL::types>([&](auto type_holder) {
-		(void)type_holder; using C = typename decltype(type_holder)::type;
-		if (ent.template HasComponent<C>())
-            this->RemoveComponentExistingImpl<C>(ent);
-	});
+	// Entities reach other threads through a synchronization point after
+	// their manager was registered, so a relaxed load is enough
+	return *s_managers[slot].load(std::memory_order_relaxed);
 }
 
 TENTITYMANAGER_TEMPLATE
-void TENTITYMANAGER_DECL::RemoveEntityExistingImpl(Entity& ent)
+void TENTITYMANAGER_DECL::RecordQuery(const component_bitset& mask, std::size_t scanned, std::size_t matched)
 {
-	RemoveComponentsExisting(ent);
+	std::lock_guard<std::mutex> lock(m_queryStatsMutex);
 
-	m_entitiesIndex.erase(ent.id);
+	auto iter = std::find_if(m_queryStats.begin(), m_queryStats.end(), [&](const std::pair<component_bitset, QueryStats>& query) {
+		return query.first == mask;
+	});
+	if (iter == m_queryStats.end())
+		iter = m_queryStats.insert(m_queryStats.end(), std::make_pair(mask, QueryStats()));
 
-	ent = Entity(); // clearing not necessary, but handy for debugging
-	ent.alive = false;
+	iter->second.runs++;
+	iter->second.scanned += scanned;
+	iter->second.matched += matched;
+}
 
-	m_entitiesFree.push_back(&ent);
+TENTITYMANAGER_TEMPLATE
+void TENTITYMANAGER_DECL::SetThreadPool(ThreadPool* threadPool)
+{
+	m_threadPool = threadPool;
 }
 
 TENTITYMANAGER_TEMPLATE
-void TENTITYMANAGER_DECL::RemoveEntityNewImpl(Entity& ent)
+bool TENTITYMANAGER_DECL::IsValid(entity_id id) const
 {
-	RemoveComponentsNew(ent);
+	if (SB_LIKELY(id.index < m_generations.size()))
+		return m_generations[id.index] == id.generation;
 
-	m_entitiesNew.erase(ent.id);
+	// Entity on a fresh index, not played back yet
+	return id.index < m_indexCount && id.generation == 1;
 }
 
 TENTITYMANAGER_TEMPLATE
-TENTITYMANAGER_DECL::TEntityManager(TEventManagerBase<CL>& eventManager)
-	: m_entityIdCounter(0)
-	, m_eventManager(eventManager)
+auto TENTITYMANAGER_DECL::GetEntity(entity_id id) -> Entity&
 {
-	static_assert(CL::count <= MAX_COMPONENTS, "MAX_COMPONENTS size is unsufficient!");
-	m_componentsIndex.resize(CL::count);
+	assert(IsValid(id) && "Tried to get an entity through a stale handle!");
+
+	if (SB_LIKELY(id.index < m_entities.size() && m_entities[id.index].alive)) {
+		return m_entities[id.index];
+	}
+	else {
+		LOG(warning) << "Performance warning: don't call GetEntity on newly constructed entities!";
+
+		void* ent = FindNew(id, FIND_ENTITY);
+		assert(ent && "New entities can only be accessed from the thread that created them!");
+		return *static_cast<Entity*>(ent);
+	}
 }
 
 TENTITYMANAGER_TEMPLATE
-auto TENTITYMANAGER_DECL::GetEntity(entity_id id) -> Entity&
+auto TENTITYMANAGER_DECL::GetEntityOrNull(entity_id id) -> Entity*
 {
-	return m_entities[m_entitiesIndex[id]];
+	return IsValid(id) ? &GetEntity(id) : nullptr;
 }
 
 TENTITYMANAGER_TEMPLATE
 template<typename C>
 C& TENTITYMANAGER_DECL::GetComponent(const Entity& ent)
 {
+	assert((!InParallelLoop() || (*t_parallelWrites)[CL::template indexOf<C>()])
+		&& "Components not declared mutable must be passed to parallel loops instead of fetched!");
+
 	if (SB_LIKELY(!ent.isnew)) {
-		return GetComponentExistingImpl<C>(ent.id);
+		return GetComponentExistingImpl<C>(ent);
 	}
 	else {
 		LOG(warning) << "Performance warning: don't call GetComponent on newly constructed entities!";
@@ -205,110 +933,172 @@ TENTITYMANAGER_TEMPLATE
 template<typename F>
 void TENTITYMANAGER_DECL::ForEachEntity(F fun)
 {
+	std::size_t matched = 0;
+
 	for (Entity& ent : m_entities) {
 		if (SB_LIKELY(ent.alive)) {
 			fun(ent);
+			matched++;
 		}
 	}
+
+	RecordQuery(component_bitset(), m_entities.size(), matched);
 }
 
 TENTITYMANAGER_TEMPLATE
 template<typename ...Cs, typename F>
 void TENTITYMANAGER_DECL::ForEachEntityWithComponents(F fun)
 {
-	for (Entity& ent : m_entities) {
-		if (SB_LIKELY(ent.alive)) {
-			if (ent.template HasComponents<Cs...>()) {
-				fun(ent, ent.template GetComponent<Cs>()...);
-			}
-		}
-	}
+	static_assert(sizeof...(Cs) > 0, "Use ForEachEntity to iterate over all entities");
+
+	std::size_t matched = 0;
+
+	const std::size_t scanned = m_storage.template ForEach<Cs...>(m_entities, [&](std::size_t slot, Cs&... components) {
+		fun(m_entities[slot], components...);
+		matched++;
+	});
+
+	RecordQuery(Entity::template BitsetOf<Cs...>(), scanned, matched);
+}
+
+TENTITYMANAGER_TEMPLATE
+template<typename ...Cs, typename F>
+void TENTITYMANAGER_DECL::ParallelForEachEntityWithComponents(F fun, std::size_t grainSize)
+{
+	GetView<Cs...>().ParallelForEach(fun, grainSize);
+}
+
+TENTITYMANAGER_TEMPLATE
+template<typename ...Cs>
+auto TENTITYMANAGER_DECL::GetView() -> View<Cs...>
+{
+	static_assert(sizeof...(Cs) > 0, "Use ForEachEntity to iterate over all entities");
+	assert(!InParallelLoop() && "Views cannot be created inside parallel loops!");
+
+	return View<Cs...>(*this, GetViewSet(Entity::template BitsetOf<std::remove_const_t<Cs>...>()));
+}
+
+TENTITYMANAGER_TEMPLATE
+template<typename ...Cs>
+void TENTITYMANAGER_DECL::MarkChanged(const Entity& ent)
+{
+	assert((!InParallelLoop() || t_parallelWrites->contains(Entity::template BitsetOf<Cs...>()))
+		&& "Only components declared mutable may be marked changed in parallel loops!");
+
+	// New entities are stamped when they are played back
+	if (SB_LIKELY(!ent.isnew))
+		StampVersions<Cs...>(GetSlot(ent));
+}
+
+TENTITYMANAGER_TEMPLATE
+std::uint32_t TENTITYMANAGER_DECL::GetTick() const
+{
+	return m_tick;
+}
+
+TENTITYMANAGER_TEMPLATE
+template<typename C>
+std::uint32_t TENTITYMANAGER_DECL::GetVersion(const Entity& ent) const
+{
+	// Entities not played back yet count as changed
+	const std::vector<std::uint32_t>& versions = m_versions[CL::template indexOf<C>()];
+	const std::size_t slot = GetSlot(ent);
+
+	return !ent.isnew && slot < versions.size() ? versions[slot] : m_tick;
 }
 
 TENTITYMANAGER_TEMPLATE
 auto TENTITYMANAGER_DECL::CreateEntity() -> Entity&
 {
-	entity_id id = GenerateId();
-	return m_entitiesNew.emplace(
-		std::piecewise_construct,
-		std::forward_as_tuple(id),
-		std::forward_as_tuple(id, *this)).first->second;
+	return RecordCreate<>().entity;
 }
 
 TENTITYMANAGER_TEMPLATE
 template<typename ...Cs>
 auto TENTITYMANAGER_DECL::CreateEntity() -> std::tuple<Entity&, Cs&...>
 {
-	Entity& ent = CreateEntity();
-    return std::forward_as_tuple(ent, AddComponentNewImpl<Cs>(ent)...);
+	CreateCommand<Cs...>& command = RecordCreate<Cs...>();
+	return std::forward_as_tuple(command.entity, std::get<Cs>(command.components)...);
 }
 
 TENTITYMANAGER_TEMPLATE
 template<typename ...Cs>
 auto TENTITYMANAGER_DECL::CreateEntity(Cs&&... cs) -> Entity&
 {
-	Entity& ent = CreateEntity();
+	return RecordCreate<std::decay_t<Cs>...>(std::forward<Cs>(cs)...).entity;
+}
 
-	std::initializer_list<int> _ = {
-        ((void)AddComponentNewImpl<std::decay_t<Cs>>(ent, std::forward<Cs>(cs)), 0)...
-	};
+TENTITYMANAGER_TEMPLATE
+template<typename ...Cs, typename F>
+entity_id TENTITYMANAGER_DECL::CreateEntities(std::size_t count, F initFn)
+{
+	const entity_id first = GenerateIds(count);
+
+	CreateBatchCommand<Cs...>& command = GetCommandBuffer().template Record<CreateBatchCommand<Cs...>>(first, count);
+
+	for (std::size_t i = 0; i < count; i++) {
+		std::tuple<Cs...>& components = command.components[i];
+		initFn(i, std::get<Cs>(components)...);
+	}
 
-	return ent;
+	return first;
 }
 
 TENTITYMANAGER_TEMPLATE
-void TENTITYMANAGER_DECL::RemoveEntity(Entity& ent)
+template<typename ...Cs>
+auto TENTITYMANAGER_DECL::Instantiate(const TPrefab<CL>& prefab) -> std::tuple<Entity&, Cs&...>
 {
-	if (SB_LIKELY(!ent.isnew)) {
-		// send signal (not necessary for new ones, because added signal had not been sent)
-        m_eventManager.template Emit<entity_removed>(ent);
+	const entity_id id = GenerateId();
+	const component_bitset bitset = prefab.GetBitset() | Entity::template BitsetOf<Cs...>();
 
-		RemoveEntityExistingImpl(ent);
-	}
-	else {
+	// Only the components of the entity are copied, packed after the command
+	typename InstantiateCommand::offset_array offsets{};
+	const std::size_t size = InstantiateCommand::Layout(bitset, offsets);
+
+	InstantiateCommand& command = GetCommandBuffer().template RecordWithPayload<InstantiateCommand>(size, id, *this, prefab, bitset, offsets);
+	return std::forward_as_tuple(command.entity, command.template Get<Cs>()...);
+}
+
+TENTITYMANAGER_TEMPLATE
+void TENTITYMANAGER_DECL::RemoveEntity(Entity& ent)
+{
+	if (SB_UNLIKELY(ent.isnew)) {
 		LOG(warning) << "Performance warning: deleting entity inserted within the same frame: " << ent.id;
-		RemoveEntityNewImpl(ent);
 	}
+
+	// Removing from m_storage moves other entities' components, which is unsafe
+	// while iterating over them, so it is deferred to Update()
+	GetCommandBuffer().template Record<DestroyCommand>(ent.id);
 }
 
 TENTITYMANAGER_TEMPLATE
 template<typename C, typename... Args>
 C& TENTITYMANAGER_DECL::AddComponent(Entity& ent, Args&&... args)
 {
-	C* comPtr = nullptr;
+	AddCommand<C>& command = GetCommandBuffer().template Record<AddCommand<C>>(ent.id, std::forward<Args>(args)...);
 
-	if (SB_LIKELY(!ent.isnew)) {
-		comPtr = &AddComponentExistingImpl<C, Args...>(ent, std::forward<Args>(args)...);
-
-        m_eventManager.template Emit<C, component_added>(ent, *comPtr);
-	}
-	else {
+	if (SB_UNLIKELY(ent.isnew)) {
 		LOG(warning) << "Performance warning: components for new entities should be directly inserted on-construction: " << ent.id;
 
-		comPtr = &AddComponentNewImpl<C, Args...>(ent, std::forward<Args>(args)...);
+		// Only the thread creating an entity has it, so its bitset can be updated right away
+		ent.template SetBit<C>(true);
 	}
 
-	return *comPtr;
+	return command.component;
 }
 
 TENTITYMANAGER_TEMPLATE
 template<typename C>
 void TENTITYMANAGER_DECL::RemoveComponent(Entity& ent)
 {
-	if (SB_LIKELY(ent.template GetBit<C>())) {
-		if (SB_LIKELY(!ent.isnew)) {
-			C& comp = ent.template GetComponent<C>();
-
-			ent.template SetBit<C>(false); // do it before emitting the event
-            m_eventManager.template Emit<C, component_removed>(ent, comp);
-
-			RemoveComponentExistingImpl<C>(ent.id);
-		}
-		else {
+	if (SB_LIKELY(ent.template HasComponent<C>())) {
+		if (SB_UNLIKELY(ent.isnew)) {
 			LOG(warning) << "Performance warning: components for new entities should not be removed in the same loop! " << ent.id;
 
-			RemoveComponentNewImpl<C>(ent.id);
+			ent.template SetBit<C>(false);
 		}
+
+		GetCommandBuffer().template Record<RemoveCommand<C>>(ent.id);
 	}
 	else {
 		LOG(warning) << "Entity " << ent.id << " does not have component " << CL::template indexOf<C>() << ", so cannot remove!";
@@ -318,56 +1108,353 @@ void TENTITYMANAGER_DECL::RemoveComponent(Entity& ent)
 TENTITYMANAGER_TEMPLATE
 void TENTITYMANAGER_DECL::Update()
 {
-	while (!m_entitiesNew.empty()) {
-		// Make copy of the new entity and remove it
-		auto iter = m_entitiesNew.begin();
-		Entity tmpEnt = iter->second;
-		m_entitiesNew.erase(iter);
+	assert(!InParallelLoop());
+
+	// Play back the command buffers of all threads. Event handlers may record
+	// new commands, also in buffers that were already played back, so repeat
+	// until none is left.
+	bool played = true;
+	while (played) {
+		{
+			std::lock_guard<std::mutex> lock(m_commandBuffersMutex);
+
+			m_commandBuffersPlayback.clear();
+			for (const auto& pair : m_commandBuffers) {
+				m_commandBuffersPlayback.push_back(pair.second.get());
+			}
+		}
 
-		// Push it to the main vector
-		tmpEnt.isnew = false;
-		m_entities.emplace_back(std::move(tmpEnt));
+		played = false;
+		for (CommandBuffer* buffer : m_commandBuffersPlayback) {
+			if (!buffer->Empty()) {
+				buffer->Play(*this);
+				played = true;
+			}
+		}
+	}
 
-		// Set its index
-		Entity& ent = m_entities.back();
-		m_entitiesIndex[ent.id] = static_cast<int>(m_entities.size() - 1);
+	// Only the entities on the kill list are visited, so the cost doesn't grow with the world
+	for (entity_id id : m_entitiesDestroyed) {
+		// Entities removed twice are gone by their second entry
+		if (Entity* ent = GetEntityExisting(id)) {
+			// send signal
+			m_eventManager.template Emit<entity_removed>(*ent);
 
-		// Do the same for its belonging components
-		TMP::ForEach<typename CL::types>([&](auto type_holder) {
-			(void)type_holder; using C = typename decltype(type_holder)::type;
+			RemoveEntityExistingImpl(*ent);
+		}
+	}
+	m_entitiesDestroyed.clear();
 
-            auto& components = this->GetComponents<C>();
-            auto& componentsNew = this->GetComponentsNew<C>();
-            auto& componentsIndex = this->GetComponentsIndex<C>();
+	m_tick++;
+}
 
-			if (ent.template HasComponent<C>()) {
-				C& com = componentsNew.at(ent.id);
+TENTITYMANAGER_TEMPLATE
+template<typename C>
+void TENTITYMANAGER_DECL::SetSerializer(std::function<void(const C&, SnapshotWriter&)> save, std::function<void(SnapshotReader&, C&)> load)
+{
+	Serializer& serializer = m_serializers[CL::template indexOf<C>()];
 
-				components.emplace_back(std::move(com));
-				componentsNew.erase(ent.id);
-				componentsIndex[ent.id] = static_cast<int>(components.size() - 1);
-			}
-		});
+	serializer.save = [save](const void* com, SnapshotWriter& writer) {
+		save(*static_cast<const C*>(com), writer);
+	};
+	serializer.load = [load](SnapshotReader& reader, void* com) {
+		load(reader, *static_cast<C*>(com));
+	};
+}
 
-		// Send signal
-        m_eventManager.template Emit<entity_added>(ent);
+TENTITYMANAGER_TEMPLATE
+std::vector<unsigned char> TENTITYMANAGER_DECL::Snapshot()
+{
+	assert(!InParallelLoop());
 
-		// Send component signals (only after they've all been added)
-		TMP::ForEach<typename CL::types>([&](auto type_holder) {
-			(void)type_holder; using C = typename decltype(type_holder)::type;
-			
-			if (ent.template HasComponent<C>()) {
-				C& com = ent.template GetComponent <C>();
+	std::vector<std::uint32_t> live;
+	for (const Entity& ent : m_entities) {
+		if (ent.alive)
+			live.push_back(ent.id.index);
+	}
 
-				m_eventManager.template Emit<C, component_added>(ent, com);
-			}
-		});
+	std::vector<std::uint32_t> entitiesFree;
+	{
+		std::lock_guard<std::mutex> lock(m_idMutex);
+		entitiesFree = m_entitiesFree;
+	}
+
+	std::vector<unsigned char> data;
+	SnapshotWriter writer(data);
+
+	writer.Write(SNAPSHOT_MAGIC);
+	writer.Write(SNAPSHOT_VERSION);
+	writer.Write(static_cast<std::uint32_t>(CL::count));
+	writer.Write(static_cast<std::uint32_t>(m_generations.size()));
+	writer.Write(static_cast<std::uint32_t>(entitiesFree.size()));
+	writer.Write(static_cast<std::uint32_t>(live.size()));
+
+	writer.WriteBytes(m_generations.data(), m_generations.size() * sizeof(std::uint32_t));
+	writer.WriteBytes(entitiesFree.data(), entitiesFree.size() * sizeof(std::uint32_t));
+	writer.WriteBytes(live.data(), live.size() * sizeof(std::uint32_t));
+
+	TMP::ForEach<typename CL::types>([&](auto type_holder) {
+		(void)type_holder; using C = typename decltype(type_holder)::type;
+		this->template SnapshotComponents<C>(writer);
+	});
+
+	return data;
+}
+
+TENTITYMANAGER_TEMPLATE
+bool TENTITYMANAGER_DECL::Restore(const std::vector<unsigned char>& snapshot)
+{
+	assert(!InParallelLoop());
+
+	SnapshotReader reader(snapshot.data(), snapshot.size());
+
+	std::uint32_t magic = 0, version = 0, componentCount = 0, generationCount = 0, freeCount = 0, liveCount = 0;
+	reader.Read(magic);
+	reader.Read(version);
+	reader.Read(componentCount);
+	reader.Read(generationCount);
+	reader.Read(freeCount);
+	reader.Read(liveCount);
+
+	if (reader.Failed() || magic != SNAPSHOT_MAGIC || version != SNAPSHOT_VERSION || componentCount != CL::count) {
+		LOG(error) << "Snapshot is invalid, or made for other components";
+		return false;
+	}
+
+	const unsigned char* generations = reader.Skip(std::size_t(generationCount) * sizeof(std::uint32_t));
+	const unsigned char* entitiesFree = reader.Skip(std::size_t(freeCount) * sizeof(std::uint32_t));
+	const unsigned char* entitiesLive = reader.Skip(std::size_t(liveCount) * sizeof(std::uint32_t));
+
+	// Check everything before touching the world. The bitsets of the entities
+	// follow from the sections, so they always match the stored components.
+	std::vector<bool> live(generationCount, false);
+	std::vector<component_bitset> bitsets(generationCount);
+	bool valid = !reader.Failed();
+
+	for (std::uint32_t i = 0; valid && i < liveCount; i++) {
+		std::uint32_t index;
+		std::memcpy(&index, entitiesLive + i * sizeof(std::uint32_t), sizeof(index));
+
+		valid = index < generationCount && !live[index];
+		if (valid)
+			live[index] = true;
+	}
+
+	const std::size_t sectionsOffset = reader.Offset();
+	TMP::ForEach<typename CL::types>([&](auto type_holder) {
+		(void)type_holder; using C = typename decltype(type_holder)::type;
+		valid = valid && this->template ScanComponents<C>(reader, live, bitsets);
+	});
+
+	if (!valid) {
+		LOG(error) << "Snapshot is corrupt";
+		return false;
 	}
 
+	// Drop the current world, including the changes not played back yet
+	{
+		std::lock_guard<std::mutex> lock(m_commandBuffersMutex);
+		for (const auto& pair : m_commandBuffers) {
+			pair.second->Clear();
+		}
+	}
+	m_entitiesDestroyed.clear();
+
 	for (Entity& ent : m_entities) {
-		if (ent.needsToDie) {
-			RemoveEntity(ent);
+		if (ent.alive) {
+			m_eventManager.template Emit<entity_removed>(ent);
+
+			RemoveEntityExistingImpl(ent);
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_idMutex);
+
+		m_generations.resize(generationCount);
+		std::memcpy(m_generations.data(), generations, std::size_t(generationCount) * sizeof(std::uint32_t));
+
+		m_entitiesFree.resize(freeCount);
+		std::memcpy(m_entitiesFree.data(), entitiesFree, std::size_t(freeCount) * sizeof(std::uint32_t));
+
+		m_indexCount = generationCount;
+	}
+
+	m_entities.clear();
+	GrowSlots(generationCount);
+
+	for (std::size_t slot = 0; slot < generationCount; slot++) {
+		if (live[slot]) {
+			Entity& ent = m_entities[slot];
+			ent = Entity(entity_id(static_cast<std::uint32_t>(slot), m_generations[slot]), *this);
+			ent.bitset = bitsets[slot];
+			ent.isnew = false;
+
+			m_storage.Insert(slot, ent.bitset);
+		}
+	}
+
+	reader.Seek(sectionsOffset);
+	bool complete = true;
+	TMP::ForEach<typename CL::types>([&](auto type_holder) {
+		(void)type_holder; using C = typename decltype(type_holder)::type;
+		complete = this->template RestoreComponents<C>(reader) && complete;
+	});
+
+	for (const Entity& ent : m_entities) {
+		if (ent.alive)
+			RefreshViews(ent);
+	}
+
+	// entities_added covers consecutive entities, so emit it for every run of live ones
+	for (std::size_t begin = 0; begin < m_entities.size();) {
+		if (!m_entities[begin].alive) {
+			begin++;
+			continue;
+		}
+
+		std::size_t end = begin + 1;
+		while (end < m_entities.size() && m_entities[end].alive)
+			end++;
+
+		m_eventManager.template Emit<entities_added>(&m_entities[begin], end - begin);
+		begin = end;
+	}
+
+	if (!complete)
+		LOG(error) << "Some components could not be loaded from the snapshot";
+
+	return complete;
+}
+
+TENTITYMANAGER_TEMPLATE
+void TENTITYMANAGER_DECL::Compact()
+{
+	assert(!InParallelLoop());
+
+	// Drop the dead spots at the end of m_entities. Their generations are kept,
+	// so handles to the entities that lived there stay stale.
+	std::size_t size = m_entities.size();
+	while (size > 0 && !m_entities[size - 1].alive)
+		size--;
+	m_entities.resize(size);
+	m_entities.shrink_to_fit();
+
+	{
+		// Hand out the lowest free indices first, so live entities gather at the front
+		std::lock_guard<std::mutex> lock(m_idMutex);
+		std::sort(m_entitiesFree.begin(), m_entitiesFree.end(), std::greater<std::uint32_t>());
+		m_entitiesFree.shrink_to_fit();
+	}
+
+	// Command arenas keep the blocks of the biggest burst of commands otherwise
+	{
+		std::lock_guard<std::mutex> lock(m_commandBuffersMutex);
+		for (auto& buffer : m_commandBuffers) {
+			if (buffer.second->Empty())
+				buffer.second->Trim();
+		}
+	}
+
+	m_storage.Compact();
+
+	for (const auto& view : m_views) {
+		view->Compact();
+	}
+}
+
+TENTITYMANAGER_TEMPLATE
+auto TENTITYMANAGER_DECL::GetStats() -> TEntityStats<CL>
+{
+	assert(!InParallelLoop());
+
+	TEntityStats<CL> stats;
+
+	for (const Entity& ent : m_entities) {
+		if (ent.alive)
+			stats.alive++;
+	}
+	stats.slots = m_entities.size();
+
+	stats.entityBytes = m_entities.capacity() * sizeof(Entity) + m_generations.capacity() * sizeof(std::uint32_t);
+	for (const std::vector<std::uint32_t>& versions : m_versions) {
+		stats.entityBytes += versions.capacity() * sizeof(std::uint32_t);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_idMutex);
+		stats.freeIndices = m_entitiesFree.size();
+		stats.entityBytes += m_entitiesFree.capacity() * sizeof(std::uint32_t);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_commandBuffersMutex);
+		stats.commandBuffers = m_commandBuffers.size();
+		for (const auto& buffer : m_commandBuffers) {
+			stats.pendingCommands += buffer.second->Size();
+			stats.commandBytes += buffer.second->BytesHeld();
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_viewsMutex);
+		stats.views = m_views.size();
+		for (const auto& view : m_views) {
+			stats.viewBytes += view->BytesHeld();
+		}
+	}
+
+	stats.sharedStorageBytes = m_storage.GetSharedBytes();
+
+	TMP::ForEach<typename CL::types>([&](auto type_holder) {
+		(void)type_holder; using C = typename decltype(type_holder)::type;
+		stats.components[CL::template indexOf<C>()] = m_storage.template GetStats<C>();
+	});
+
+	{
+		std::lock_guard<std::mutex> lock(m_queryStatsMutex);
+		stats.queries = m_queryStats;
+	}
+
+	return stats;
+}
+
+TENTITYMANAGER_TEMPLATE
+void TENTITYMANAGER_DECL::ResetQueryStats()
+{
+	std::lock_guard<std::mutex> lock(m_queryStatsMutex);
+	m_queryStats.clear();
+}
+
+TENTITYMANAGER_TEMPLATE
+void TENTITYMANAGER_DECL::LogStats()
+{
+	const TEntityStats<CL> stats = GetStats();
+
+	LOG(info) << "Entities: " << stats.alive << " alive in " << stats.slots << " slots, "
+		<< stats.freeIndices << " free indices, " << stats.entityBytes << " bytes";
+	LOG(info) << "Commands: " << stats.pendingCommands << " pending in " << stats.commandBuffers << " buffers, "
+		<< stats.commandBytes << " bytes";
+	LOG(info) << "Views: " << stats.views << ", " << stats.viewBytes << " bytes; shared storage: "
+		<< stats.sharedStorageBytes << " bytes";
+
+	for (std::size_t index = 0; index < CL::count; index++) {
+		const ComponentStats& component = stats.components[index];
+		LOG(info) << "Component " << index << ": " << component.live << " live, capacity " << component.capacity
+			<< ", index " << component.indexSize << " (load " << component.LoadFactor() << "), "
+			<< component.bytes << " bytes";
+	}
+
+	for (const auto& query : stats.queries) {
+		std::ostringstream components;
+		for (std::size_t index = 0; index < CL::count; index++) {
+			if (query.first[index])
+				components << (components.tellp() > 0 ? "," : "") << index;
 		}
+
+		const QueryStats& queryStats = query.second;
+		LOG(info) << "Query {" << components.str() << "}: " << queryStats.runs << " runs, "
+			<< queryStats.matched << " of " << queryStats.scanned << " entities scanned matched";
 	}
 }
 
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <utility>
+
+namespace Starbase {
+
+#define TEVENTQUEUE_TEMPLATE \
+template<typename E>
+
+#define TEVENTQUEUE_DECL \
+TEventQueue<E>
+
+TEVENTQUEUE_TEMPLATE
+template<typename... Args>
+void TEVENTQUEUE_DECL::Push(Args&&... args)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_events.emplace_back(std::forward<Args>(args)...);
+}
+
+TEVENTQUEUE_TEMPLATE
+void TEVENTQUEUE_DECL::Push(const E* events, std::size_t count)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_events.insert(m_events.end(), events, events + count);
+}
+
+TEVENTQUEUE_TEMPLATE
+std::vector<E>& TEVENTQUEUE_DECL::Take()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_dispatching.clear();
+	m_dispatching.swap(m_events);
+
+	return m_dispatching;
+}
+
+} // namespace Starbase
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <utility>
+
+#include "tmp.hpp"
+
+namespace Starbase {
+
+#define TPOOLSTORAGE_TEMPLATE \
+template<typename CL>
+
+#define TPOOLSTORAGE_DECL \
+TPoolStorage<CL>
+
+TPOOLSTORAGE_TEMPLATE
+template<typename C>
+TComponentPool<C>& TPOOLSTORAGE_DECL::GetPool()
+{
+	return std::get<TComponentPool<C>>(m_pools);
+}
+
+TPOOLSTORAGE_TEMPLATE
+void TPOOLSTORAGE_DECL::Insert(std::size_t, const component_bitset&)
+{}
+
+TPOOLSTORAGE_TEMPLATE
+void TPOOLSTORAGE_DECL::Reserve(const component_bitset& bitset, std::size_t slotCount, std::size_t count)
+{
+	TMP::ForEach<typename CL::types>([&](auto type_holder) {
+		(void)type_holder; using C = typename decltype(type_holder)::type;
+		if (Entity::template HasComponent<C>(bitset))
+			this->template GetPool<C>().Reserve(slotCount, count);
+	});
+}
+
+TPOOLSTORAGE_TEMPLATE
+template<typename C, typename... Args>
+C& TPOOLSTORAGE_DECL::Emplace(std::size_t slot, Args&&... args)
+{
+	return Add<C>(slot, component_bitset(), std::forward<Args>(args)...);
+}
+
+TPOOLSTORAGE_TEMPLATE
+template<typename C, typename... Args>
+C& TPOOLSTORAGE_DECL::Add(std::size_t slot, const component_bitset&, Args&&... args)
+{
+	return GetPool<C>().Add(slot, std::forward<Args>(args)...);
+}
+
+TPOOLSTORAGE_TEMPLATE
+template<typename C>
+C& TPOOLSTORAGE_DECL::Get(std::size_t slot)
+{
+	return GetPool<C>().Get(slot);
+}
+
+TPOOLSTORAGE_TEMPLATE
+template<typename C>
+void TPOOLSTORAGE_DECL::Remove(std::size_t slot, const component_bitset&)
+{
+	GetPool<C>().Remove(slot);
+}
+
+TPOOLSTORAGE_TEMPLATE
+void TPOOLSTORAGE_DECL::Erase(std::size_t slot, const component_bitset& bitset)
+{
+	TMP::ForEach<typename CL::types>([&](auto type_holder) {
+		(void)type_holder; using C = typename decltype(type_holder)::type;
+		if (Entity::template HasComponent<C>(bitset))
+			this->template Remove<C>(slot, bitset);
+	});
+}
+
+TPOOLSTORAGE_TEMPLATE
+void TPOOLSTORAGE_DECL::Compact()
+{
+	TMP::ForEach<typename CL::types>([&](auto type_holder) {
+		(void)type_holder; using C = typename decltype(type_holder)::type;
+		this->template GetPool<C>().Compact();
+	});
+}
+
+TPOOLSTORAGE_TEMPLATE
+template<typename C, typename F>
+void TPOOLSTORAGE_DECL::ForEachArray(F fun)
+{
+	TComponentPool<C>& pool = GetPool<C>();
+	if (pool.Size() > 0)
+		fun(pool.GetSlots().data(), pool.GetData(), pool.Size());
+}
+
+TPOOLSTORAGE_TEMPLATE
+template<typename C>
+ComponentStats TPOOLSTORAGE_DECL::GetStats() const
+{
+	return std::get<TComponentPool<C>>(m_pools).GetStats();
+}
+
+TPOOLSTORAGE_TEMPLATE
+std::size_t TPOOLSTORAGE_DECL::GetSharedBytes() const
+{
+	// Every pool indexes the entities on its own
+	return 0;
+}
+
+TPOOLSTORAGE_TEMPLATE
+template<typename ...Cs, typename F>
+std::size_t TPOOLSTORAGE_DECL::ForEach(const std::vector<Entity>& entities, F fun)
+{
+	// Walk the pool with the fewest components, and skip entities lacking any of the others
+	const std::vector<std::uint32_t>* slots = nullptr;
+	(void)std::initializer_list<int>{
+		((!slots || GetPool<Cs>().GetSlots().size() < slots->size()) ? ((void)(slots = &GetPool<Cs>().GetSlots()), 0) : 0)...
+	};
+
+	for (std::size_t i = 0; i < slots->size(); i++) {
+		const std::size_t slot = (*slots)[i];
+		if (Entity::template HasComponents<Cs...>(entities[slot].bitset)) {
+			fun(slot, Get<Cs>(slot)...);
+		}
+	}
+
+	return slots->size();
+}
+
+} // namespace Starbase
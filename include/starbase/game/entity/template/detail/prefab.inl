@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cassert>
+#include <utility>
+
+namespace Starbase {
+
+#define TPREFAB_TEMPLATE \
+template<typename CL>
+
+#define TPREFAB_DECL \
+TPrefab<CL>
+
+TPREFAB_TEMPLATE
+TPREFAB_DECL::TPrefab()
+	: m_components()
+{}
+
+TPREFAB_TEMPLATE
+template<typename C>
+C& TPREFAB_DECL::Set(C component)
+{
+	m_bitset.set(CL::template indexOf<C>());
+
+	C& com = std::get<C>(m_components);
+	com = std::move(component);
+	return com;
+}
+
+TPREFAB_TEMPLATE
+template<typename C>
+bool TPREFAB_DECL::Has() const
+{
+	return TEntity<CL>::template HasComponent<C>(m_bitset);
+}
+
+TPREFAB_TEMPLATE
+template<typename C>
+const C& TPREFAB_DECL::Get() const
+{
+	assert(Has<C>() && "Prefab does not have this component");
+	return std::get<C>(m_components);
+}
+
+} // namespace Starbase
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <starbase/starbase.hpp>
+#include <starbase/game/logging.hpp>
+
+namespace Starbase {
+
+#define TSHAREDTABLE_TEMPLATE \
+template<typename T>
+
+#define TSHAREDTABLE_DECL \
+TSharedTable<T>
+
+TSHAREDTABLE_TEMPLATE
+constexpr std::size_t TSHAREDTABLE_DECL::BLOCK_SIZE;
+
+TSHAREDTABLE_TEMPLATE
+constexpr std::size_t TSHAREDTABLE_DECL::MAX_BLOCKS;
+
+TSHAREDTABLE_TEMPLATE
+TSHAREDTABLE_DECL::TSharedTable()
+	: m_count(1)
+{
+	m_blocks[0].reset(new T[BLOCK_SIZE]);
+	m_indices.emplace(T(), 0);
+}
+
+TSHAREDTABLE_TEMPLATE
+auto TSHAREDTABLE_DECL::Instance() -> TSharedTable&
+{
+	static TSharedTable table;
+	return table;
+}
+
+TSHAREDTABLE_TEMPLATE
+std::uint32_t TSHAREDTABLE_DECL::Intern(const T& value)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto it = m_indices.find(value);
+	if (it != m_indices.end())
+		return it->second;
+
+	const std::uint32_t index = m_count.load(std::memory_order_relaxed);
+	if (SB_UNLIKELY(index == BLOCK_SIZE * MAX_BLOCKS)) {
+		LOG(error) << "Shared value table is full, using the default value";
+		return 0;
+	}
+
+	std::unique_ptr<T[]>& block = m_blocks[index / BLOCK_SIZE];
+	if (!block)
+		block.reset(new T[BLOCK_SIZE]);
+
+	block[index % BLOCK_SIZE] = value;
+	m_indices.emplace(value, index);
+
+	m_count.store(index + 1, std::memory_order_release);
+	return index;
+}
+
+} // namespace Starbase
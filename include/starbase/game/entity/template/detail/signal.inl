@@ -0,0 +1,206 @@
+#pragma once
+
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+#include <new>
+#include <utility>
+
+#include <starbase/starbase.hpp>
+
+namespace Starbase {
+
+#define TDELEGATE_TEMPLATE \
+template<typename R, typename ...Args>
+
+#define TDELEGATE_DECL \
+TDelegate<R(Args...)>
+
+#define TSIGNAL_TEMPLATE \
+template<typename ...Args>
+
+#define TSIGNAL_DECL \
+TSignal<void(Args...)>
+
+TDELEGATE_TEMPLATE
+constexpr std::size_t TDELEGATE_DECL::INLINE_BYTES;
+
+TDELEGATE_TEMPLATE
+template<typename F>
+R TDELEGATE_DECL::Invoke(void* storage, Args... args)
+{
+	return (*static_cast<F*>(storage))(std::forward<Args>(args)...);
+}
+
+TDELEGATE_TEMPLATE
+template<typename F>
+void TDELEGATE_DECL::Manage(void* dest, void* src)
+{
+	if (src) {
+		new (dest) F(std::move(*static_cast<F*>(src)));
+		static_cast<F*>(src)->~F();
+	} else {
+		static_cast<F*>(dest)->~F();
+	}
+}
+
+TDELEGATE_TEMPLATE
+TDELEGATE_DECL::TDelegate()
+	: m_invoke(nullptr)
+	, m_manage(nullptr)
+{}
+
+TDELEGATE_TEMPLATE
+template<typename F, typename>
+TDELEGATE_DECL::TDelegate(F&& fun)
+{
+	using Fn = std::decay_t<F>;
+
+	static_assert(sizeof(Fn) <= INLINE_BYTES, "Callable too big for a delegate, capture less or by pointer");
+	static_assert(alignof(Fn) <= alignof(storage_type), "Callable too aligned for a delegate");
+
+	new (&m_storage) Fn(std::forward<F>(fun));
+	m_invoke = &Invoke<Fn>;
+	m_manage = std::is_trivially_copyable<Fn>::value ? nullptr : &Manage<Fn>;
+}
+
+TDELEGATE_TEMPLATE
+TDELEGATE_DECL::TDelegate(TDelegate&& other)
+	: m_invoke(other.m_invoke)
+	, m_manage(other.m_manage)
+{
+	if (m_manage)
+		m_manage(&m_storage, &other.m_storage);
+	else
+		std::memcpy(&m_storage, &other.m_storage, sizeof(storage_type));
+
+	other.m_invoke = nullptr;
+	other.m_manage = nullptr;
+}
+
+TDELEGATE_TEMPLATE
+auto TDELEGATE_DECL::operator=(TDelegate&& other) -> TDelegate&
+{
+	if (this != &other) {
+		Reset();
+
+		m_invoke = other.m_invoke;
+		m_manage = other.m_manage;
+
+		if (m_manage)
+			m_manage(&m_storage, &other.m_storage);
+		else
+			std::memcpy(&m_storage, &other.m_storage, sizeof(storage_type));
+
+		other.m_invoke = nullptr;
+		other.m_manage = nullptr;
+	}
+	return *this;
+}
+
+TDELEGATE_TEMPLATE
+TDELEGATE_DECL::~TDelegate()
+{
+	Reset();
+}
+
+TDELEGATE_TEMPLATE
+void TDELEGATE_DECL::Reset()
+{
+	if (m_manage)
+		m_manage(&m_storage, nullptr);
+
+	m_invoke = nullptr;
+	m_manage = nullptr;
+}
+
+TDELEGATE_TEMPLATE
+R TDELEGATE_DECL::operator()(Args... args) const
+{
+	assert(m_invoke && "Called an empty delegate!");
+	return m_invoke(const_cast<storage_type*>(&m_storage), std::forward<Args>(args)...);
+}
+
+TSIGNAL_TEMPLATE
+TSIGNAL_DECL::TSignal()
+	: m_nextId(1)
+	, m_emitting(0)
+	, m_disconnected(false)
+{}
+
+TSIGNAL_TEMPLATE
+template<typename F>
+SignalConnection TSIGNAL_DECL::Connect(F&& fun)
+{
+	const std::uint32_t id = m_nextId++;
+
+	// Adding to m_slots while emitting could move the listener being called
+	std::vector<Slot>& slots = m_emitting > 0 ? m_pending : m_slots;
+	slots.push_back(Slot{ delegate_type(std::forward<F>(fun)), id });
+
+	return SignalConnection(this, &DisconnectFromHandle, id);
+}
+
+TSIGNAL_TEMPLATE
+void TSIGNAL_DECL::DisconnectFromHandle(void* signal, std::uint32_t id)
+{
+	static_cast<TSignal*>(signal)->Disconnect(id);
+}
+
+TSIGNAL_TEMPLATE
+void TSIGNAL_DECL::Disconnect(std::uint32_t id)
+{
+	auto matches = [id](const Slot& slot) { return slot.id == id; };
+
+	auto pending = std::find_if(m_pending.begin(), m_pending.end(), matches);
+	if (pending != m_pending.end()) {
+		m_pending.erase(pending);
+		return;
+	}
+
+	auto iter = std::find_if(m_slots.begin(), m_slots.end(), matches);
+	if (iter == m_slots.end())
+		return;
+
+	// The listener may be the one running, so only mark it while emitting
+	if (m_emitting > 0) {
+		iter->id = 0;
+		m_disconnected = true;
+	} else {
+		m_slots.erase(iter);
+	}
+}
+
+TSIGNAL_TEMPLATE
+void TSIGNAL_DECL::Flush()
+{
+	if (m_disconnected) {
+		m_slots.erase(std::remove_if(m_slots.begin(), m_slots.end(), [](const Slot& slot) {
+			return slot.id == 0;
+		}), m_slots.end());
+		m_disconnected = false;
+	}
+
+	if (!m_pending.empty()) {
+		std::move(m_pending.begin(), m_pending.end(), std::back_inserter(m_slots));
+		m_pending.clear();
+	}
+}
+
+TSIGNAL_TEMPLATE
+void TSIGNAL_DECL::Emit(Args... args)
+{
+	m_emitting++;
+
+	// Listeners can't add to m_slots meanwhile, so it stays in place
+	for (const Slot& slot : m_slots) {
+		if (SB_LIKELY(slot.id != 0))
+			slot.delegate(args...);
+	}
+
+	if (--m_emitting == 0)
+		Flush();
+}
+
+} // namespace Starbase
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cassert>
+#include <cstring>
+
+namespace Starbase {
+
+#define TSOAVECTOR_TEMPLATE \
+template<typename T, typename Scalar>
+
+#define TSOAVECTOR_DECL \
+TSoAVector<T, Scalar>
+
+TSOAVECTOR_TEMPLATE
+constexpr std::size_t TSOAVECTOR_DECL::LANES;
+
+TSOAVECTOR_TEMPLATE
+void TSOAVECTOR_DECL::Clear()
+{
+	for (std::vector<Scalar>& lane : m_lanes) {
+		lane.clear();
+	}
+}
+
+TSOAVECTOR_TEMPLATE
+void TSOAVECTOR_DECL::Reserve(std::size_t capacity)
+{
+	for (std::vector<Scalar>& lane : m_lanes) {
+		lane.reserve(capacity);
+	}
+}
+
+TSOAVECTOR_TEMPLATE
+void TSOAVECTOR_DECL::Resize(std::size_t size)
+{
+	for (std::vector<Scalar>& lane : m_lanes) {
+		lane.resize(size);
+	}
+}
+
+TSOAVECTOR_TEMPLATE
+void TSOAVECTOR_DECL::PushBack(const T& value)
+{
+	Scalar scalars[LANES];
+	std::memcpy(scalars, &value, sizeof(T));
+
+	for (std::size_t lane = 0; lane < LANES; lane++) {
+		m_lanes[lane].push_back(scalars[lane]);
+	}
+}
+
+TSOAVECTOR_TEMPLATE
+T TSOAVECTOR_DECL::Get(std::size_t index) const
+{
+	assert(index < Size());
+
+	Scalar scalars[LANES];
+	for (std::size_t lane = 0; lane < LANES; lane++) {
+		scalars[lane] = m_lanes[lane][index];
+	}
+
+	T value;
+	std::memcpy(&value, scalars, sizeof(T));
+	return value;
+}
+
+TSOAVECTOR_TEMPLATE
+void TSOAVECTOR_DECL::Set(std::size_t index, const T& value)
+{
+	assert(index < Size());
+
+	Scalar scalars[LANES];
+	std::memcpy(scalars, &value, sizeof(T));
+
+	for (std::size_t lane = 0; lane < LANES; lane++) {
+		m_lanes[lane][index] = scalars[lane];
+	}
+}
+
+} // namespace Starbase
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cassert>
+#include <algorithm>
+#include <type_traits>
+
+namespace Starbase {
+
+#define TVIEWSET_TEMPLATE \
+template<typename CL>
+
+#define TVIEWSET_DECL \
+TViewSet<CL>
+
+#define TVIEW_TEMPLATE \
+template<typename CL, typename ...Cs>
+
+#define TVIEW_DECL \
+TView<CL, Cs...>
+
+TVIEWSET_TEMPLATE
+void TVIEWSET_DECL::Insert(std::size_t slot)
+{
+	if (m_positions.size() <= slot)
+		m_positions.resize(slot + 1, -1);
+
+	m_positions[slot] = static_cast<std::int32_t>(m_slots.size());
+	m_slots.push_back(static_cast<std::uint32_t>(slot));
+}
+
+TVIEWSET_TEMPLATE
+void TVIEWSET_DECL::Erase(std::size_t slot)
+{
+	const std::size_t position = static_cast<std::size_t>(m_positions[slot]);
+
+	m_slots[position] = m_slots.back();
+	m_positions[m_slots[position]] = static_cast<std::int32_t>(position);
+
+	m_slots.pop_back();
+	m_positions[slot] = -1;
+}
+
+TVIEWSET_TEMPLATE
+void TVIEWSET_DECL::Refresh(std::size_t slot, const component_bitset& bitset)
+{
+	const bool matches = bitset.contains(m_mask);
+	const bool contained = slot < m_positions.size() && m_positions[slot] >= 0;
+
+	if (matches && !contained)
+		Insert(slot);
+	else if (!matches && contained)
+		Erase(slot);
+}
+
+TVIEWSET_TEMPLATE
+void TVIEWSET_DECL::Compact()
+{
+	std::sort(m_slots.begin(), m_slots.end());
+	m_slots.shrink_to_fit();
+
+	m_positions.assign(m_slots.empty() ? 0 : m_slots.back() + 1, -1);
+	m_positions.shrink_to_fit();
+
+	for (std::size_t i = 0; i < m_slots.size(); i++) {
+		m_positions[m_slots[i]] = static_cast<std::int32_t>(i);
+	}
+}
+
+TVIEW_TEMPLATE
+template<typename F>
+void TVIEW_DECL::ForEach(F fun)
+{
+	const std::vector<std::uint32_t>& slots = m_set.GetSlots();
+
+	for (std::size_t i = 0; i < slots.size(); i++) {
+		const std::size_t slot = slots[i];
+		fun(m_entityManager.m_entities[slot], m_entityManager.m_storage.template Get<std::remove_const_t<Cs>>(slot)...);
+	}
+
+	m_entityManager.RecordQuery(m_set.GetMask(), slots.size(), slots.size());
+}
+
+TVIEW_TEMPLATE
+template<typename C, typename F>
+void TVIEW_DECL::ForEachChangedSince(std::uint32_t tick, F fun)
+{
+	const int index = CL::template indexOf<std::remove_const_t<C>>();
+	assert(m_set.GetMask()[index] && "Changes can only be tracked for components of the view!");
+
+	const std::vector<std::uint32_t>& slots = m_set.GetSlots();
+	const std::vector<std::uint32_t>& versions = m_entityManager.m_versions[index];
+	std::size_t matched = 0;
+
+	for (std::size_t i = 0; i < slots.size(); i++) {
+		const std::size_t slot = slots[i];
+		if (versions[slot] >= tick) {
+			fun(m_entityManager.m_entities[slot], m_entityManager.m_storage.template Get<std::remove_const_t<Cs>>(slot)...);
+			matched++;
+		}
+	}
+
+	m_entityManager.RecordQuery(m_set.GetMask(), slots.size(), matched);
+}
+
+TVIEW_TEMPLATE
+template<typename F>
+void TVIEW_DECL::ParallelForEach(F fun, std::size_t grainSize)
+{
+	using EntityManager = TEntityManager<CL>;
+
+	assert(!EntityManager::InParallelLoop() && "Parallel loops cannot be nested!");
+
+	const std::vector<std::uint32_t>& slots = m_set.GetSlots();
+	EntityManager& entityManager = m_entityManager;
+	const typename EntityManager::component_bitset writes = EntityManager::template MutableBitsetOf<Cs...>();
+
+	const ThreadPool::range_function range = [&](std::size_t begin, std::size_t end) {
+		typename EntityManager::ParallelLoopScope scope(writes);
+
+		for (std::size_t i = begin; i < end; i++) {
+			const std::size_t slot = slots[i];
+			fun(entityManager.m_entities[slot], entityManager.m_storage.template Get<std::remove_const_t<Cs>>(slot)...);
+		}
+	};
+
+	if (entityManager.m_threadPool)
+		entityManager.m_threadPool->ParallelFor(slots.size(), grainSize, range);
+	else
+		range(0, slots.size());
+
+	entityManager.RecordQuery(m_set.GetMask(), slots.size(), slots.size());
+}
+
+} // namespace Starbase
@@ -1,50 +1,90 @@
 #pragma once
 
 #include <cstdint>
-#include <bitset>
+#include <ostream>
 
+#include "component_mask.hpp"
 #include "detail/tmp.hpp"
 
 namespace Starbase {
 
-typedef std::uint64_t entity_id;
+// Handle to an entity: the index of its slot in the entity manager, and the
+// generation of that slot, which is bumped whenever the slot is freed. A
+// stale handle thus never resolves to the entity that reused its slot.
+// Generations start at 1, so a default constructed handle is never valid.
+struct entity_id {
+	std::uint32_t index;
+	std::uint32_t generation;
 
-static constexpr int MAX_COMPONENTS = 16;
+	entity_id()
+		: index(0), generation(0)
+	{}
+
+	entity_id(std::uint32_t index, std::uint32_t generation)
+		: index(index), generation(generation)
+	{}
+
+	explicit operator bool() const
+	{ return generation != 0; }
+};
+
+static inline bool operator==(const entity_id& a, const entity_id& b)
+{
+	return a.index == b.index && a.generation == b.generation;
+}
+
+static inline bool operator!=(const entity_id& a, const entity_id& b)
+{
+	return !(a == b);
+}
+
+static inline bool operator<(const entity_id& a, const entity_id& b)
+{
+	return a.index < b.index || (a.index == b.index && a.generation < b.generation);
+}
+
+static inline std::ostream& operator<<(std::ostream& os, const entity_id& id)
+{
+	return os << id.index << ':' << id.generation;
+}
+
+// Width of the component masks; configured by CMake, 64, 128 or 256
+#ifndef STARBASE_MAX_COMPONENTS
+#define STARBASE_MAX_COMPONENTS 64
+#endif
+
+static constexpr int MAX_COMPONENTS = STARBASE_MAX_COMPONENTS;
 
 template<typename CL>
 class TEntityManager;
 
 template<typename CL>
 struct TEntity {
-	typedef std::bitset<MAX_COMPONENTS> component_bitset;
+	typedef TComponentMask<MAX_COMPONENTS> component_bitset;
 
 	entity_id id;
 	component_bitset bitset;
 	bool alive : 1;
-	bool needsToDie : 1;
 	bool isnew : 1;
 
 public:
-	explicit TEntity(entity_id id, TEntityManager<CL>& entityManager)
-		: id(id)
-		, alive(true)
-		, needsToDie(false)
-		, isnew(true)
-		, entityManager(&entityManager)
-	{}
+	explicit TEntity(entity_id id, TEntityManager<CL>& entityManager);
 
 	explicit TEntity()
-		: id(0)
+		: id()
 		, alive(false)
-		, needsToDie(false)
 		, isnew(false)
-		, entityManager(nullptr)
+		, manager(0)
 	{}
 
 	friend TEntityManager<CL>;
 
 private:
-	TEntityManager<CL>* entityManager;
+	// Slot of the owning manager, see TEntityManager::FromSlot(). Unlike a
+	// pointer, it fits in the padding after the flags.
+	std::uint8_t manager;
+
+	TEntityManager<CL>& GetManager() const;
 
 	template<typename C>
 	void SetBit(component_bitset& bitset, bool val);
@@ -53,9 +93,14 @@ private:
 	void SetBit(bool val);
 
 public:
+	// Evaluated at compile time where it matters, see HasComponents()
+	template<typename ...Cs>
+	static constexpr component_bitset BitsetOf();
+
 	template<typename C>
 	static bool HasComponent(const component_bitset& bitset);
 
+	// A single AND/compare of the whole mask against the constant mask of Cs
 	template<typename ...Cs>
 	static bool HasComponents(const component_bitset& bitset);
 
@@ -71,6 +116,10 @@ public:
 	template<typename C>
 	C* GetComponentOrNull() const;
 
+	// See TEntityManager::MarkChanged()
+	template<typename ...Cs>
+	void MarkChanged() const;
+
 	template<typename C, typename... Args>
 	C& AddComponent(Args&&... args);
 
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <utility>
+#include <vector>
+
+#include "entity.hpp"
+
+namespace Starbase {
+
+// Occupancy of the storage of one component type
+struct ComponentStats {
+	std::size_t live;      // components stored
+	std::size_t capacity;  // components fitting in the memory held
+	std::size_t indexSize; // entries of the map from entity slots to components
+	std::size_t bytes;     // memory held, including spare capacity and the index
+
+	ComponentStats() : live(0), capacity(0), indexSize(0), bytes(0) {}
+
+	// Fraction of the index pointing at a component
+	double LoadFactor() const
+	{ return indexSize > 0 ? double(live) / double(indexSize) : 0.0; }
+};
+
+// Entities visited by the loops over one set of components
+struct QueryStats {
+	std::uint64_t runs;
+	std::uint64_t scanned; // entities looked at
+	std::uint64_t matched; // entities passed to the loop body
+
+	QueryStats() : runs(0), scanned(0), matched(0) {}
+};
+
+// Snapshot of the memory and iteration statistics of an entity manager, see
+// TEntityManager::GetStats()
+template<typename CL>
+struct TEntityStats {
+	using component_bitset = typename TEntity<CL>::component_bitset;
+
+	std::size_t alive;       // entities played back and not removed
+	std::size_t slots;       // size of the entity array, dead spots included
+	std::size_t freeIndices; // entity indices waiting to be reused
+	std::size_t entityBytes; // entity array, generations and versions
+
+	std::size_t pendingCommands; // recorded, not played back yet
+	std::size_t commandBuffers;
+	std::size_t commandBytes; // arenas of the command buffers
+
+	std::size_t views;
+	std::size_t viewBytes;
+
+	// Storage memory not belonging to a single component type
+	std::size_t sharedStorageBytes;
+
+	std::array<ComponentStats, CL::count> components;
+
+	// Since the last ResetQueryStats(), by the components the loops asked for
+	std::vector<std::pair<component_bitset, QueryStats>> queries;
+
+	TEntityStats()
+		: alive(0), slots(0), freeIndices(0), entityBytes(0)
+		, pendingCommands(0), commandBuffers(0), commandBytes(0)
+		, views(0), viewBytes(0), sharedStorageBytes(0)
+	{}
+};
+
+} // namespace Starbase
@@ -1,15 +1,29 @@
 #pragma once
 
+#include <cstdint>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
 #include <vector>
-#include <map>
-#include <unordered_map>
 #include <tuple>
 
 #include <starbase/starbase.hpp>
+#include <starbase/game/thread_pool.hpp>
 
 #include "component_list.hpp"
 #include "entity.hpp"
 #include "eventmanager.hpp"
+#include "pool_storage.hpp"
+#include "archetype_storage.hpp"
+#include "command_buffer.hpp"
+#include "entity_stats.hpp"
+#include "prefab.hpp"
+#include "snapshot_stream.hpp"
+#include "view.hpp"
 
 namespace Starbase {
 
@@ -20,53 +34,221 @@ public:
 
 	using component_bitset = typename TEntity<CL>::component_bitset;
 
+	template<typename ...Cs>
+	using View = TView<CL, Cs...>;
+
 	friend Entity;
 
+	template<typename, typename...>
+	friend class TView;
+
 private:
 	using entity_added = typename TEventManagerBase<CL>::entity_added;
 	using entity_removed = typename TEventManagerBase<CL>::entity_removed;
+	using entities_added = typename TEventManagerBase<CL>::entities_added;
 	using component_added = typename TEventManagerBase<CL>::component_added;
 	using component_removed = typename TEventManagerBase<CL>::component_removed;
 
-	entity_id m_entityIdCounter;
+	using CommandBuffer = TCommandBuffer<CL>;
+	using Command = typename CommandBuffer::Command;
+
+	// Index passed to Command::find to get the entity of a create command
+	static constexpr int FIND_ENTITY = -1;
+
+	// The commands recorded by CreateEntity, CreateEntities, Instantiate, AddComponent, RemoveComponent and RemoveEntity
+	template<typename ...Cs>
+	struct CreateCommand;
+
+	template<typename ...Cs>
+	struct CreateBatchCommand;
+
+	struct InstantiateCommand;
+
+	template<typename C>
+	struct AddCommand;
 
-	// The list of entities that systems iterate over,
-	// unused spots are marked with active=false
+	template<typename C>
+	struct RemoveCommand;
+
+	struct DestroyCommand;
+
+	// Saves and loads a component that cannot be copied as is, see SetSerializer()
+	struct Serializer {
+		std::function<void(const void*, SnapshotWriter&)> save;
+		std::function<void(SnapshotReader&, void*)> load;
+	};
+
+	// Layout of Snapshot(): a header, the generation table, the free list and
+	// the live entity indices, followed by one section per component type
+	static constexpr std::uint32_t SNAPSHOT_MAGIC = 0x4e534253; // "SBSN"
+	static constexpr std::uint32_t SNAPSHOT_VERSION = 1;
+
+	// How the components of a section are stored
+	enum SectionKind : std::uint32_t {
+		SECTION_SKIPPED,
+		SECTION_RAW,
+		SECTION_SERIALIZED
+	};
+
+	struct CommandBufferCache {
+		std::uint64_t serial;
+		CommandBuffer* buffer;
+	};
+
+	// The list of entities that systems iterate over, indexed by entity_id::index.
+	// Unused spots and spots reserved for new entities are marked with alive=false
 	std::vector<Entity> m_entities;
 
-	// Newly added (non-indexed) entities. Added to m_entities after Refresh()
-	std::map<entity_id, Entity> m_entitiesNew;
+	// Current generation of every entity index played back so far
+	std::vector<std::uint32_t> m_generations;
+
+	// Number of entity indices handed out, including those of entities not played back yet
+	std::atomic<std::uint32_t> m_indexCount;
+
+	// Indices of empty spots in m_entities, reused by new entities before growing it
+	std::vector<std::uint32_t> m_entitiesFree;
+
+	// Guards m_entitiesFree and m_indexCount, as entities may be created on any thread
+	std::mutex m_idMutex;
+
+	// Components of the entities in m_entities, addressed by their index (slot)
+	typename CL::storage_type m_storage;
+
+	// Tick of the last change to each component, per component type and slot
+	std::array<std::vector<std::uint32_t>, CL::count> m_versions;
+
+	// Current tick, advanced by Update(); 0 is older than any change
+	std::uint32_t m_tick;
+
+	// Structural changes recorded by every thread, played back by Update()
+	std::vector<std::pair<std::thread::id, std::unique_ptr<CommandBuffer>>> m_commandBuffers;
+	std::mutex m_commandBuffersMutex;
+	std::vector<CommandBuffer*> m_commandBuffersPlayback;
+
+	// Kill list: entities removed by the commands being played back
+	std::vector<entity_id> m_entitiesDestroyed;
 
-	// Pointers to keep track of empty spots in m_entities (active=false)
-	std::vector<Entity*> m_entitiesFree;
+	std::array<Serializer, CL::count> m_serializers;
 
-	// For each entity_id, its index in the m_entities vector (except new entities)
-	std::unordered_map<entity_id, int> m_entitiesIndex;
+	// Identifies this manager in the thread-local command buffer cache
+	const std::uint64_t m_serial;
+	static std::atomic<std::uint64_t> s_serialCounter;
+	static thread_local CommandBufferCache t_commandBuffer;
 
-	// same principle goes here, except that components don't have an active flag
-	typename CL::vector_type m_components;
-	typename CL::map_type m_componentsNew;
-	typename CL::freelist_type m_componentsFree;
-	typename CL::index_type m_componentsIndex;
+	// Managers alive, by the slot their entities refer to them with
+	static constexpr std::size_t MAX_MANAGERS = 256;
+	static std::array<std::atomic<TEntityManager*>, MAX_MANAGERS> s_managers;
+	const std::uint8_t m_slot;
+
+	static std::uint8_t AcquireSlot(TEntityManager* entityManager);
+
+	static TEntityManager& FromSlot(std::uint8_t slot);
+
+	// Entity sets of the views handed out by GetView()
+	std::vector<std::unique_ptr<TViewSet<CL>>> m_views;
+
+	// Guards m_views, as concurrently scheduled systems may look up views
+	std::mutex m_viewsMutex;
 
 	TEventManagerBase<CL>& m_eventManager;
 
+	// Runs ParallelForEachEntityWithComponents(), or nullptr to run it inline
+	ThreadPool* m_threadPool;
+
+	// Entities scanned and matched by the loops, per set of components they
+	// asked for; guarded, as systems may loop concurrently
+	std::vector<std::pair<component_bitset, QueryStats>> m_queryStats;
+	std::mutex m_queryStatsMutex;
+
+	void RecordQuery(const component_bitset& mask, std::size_t scanned, std::size_t matched);
+
+#ifndef NDEBUG
+	// Components declared mutable by the parallel loop running on this thread,
+	// or nullptr outside parallel loops
+	static thread_local const component_bitset* t_parallelWrites;
+#endif
+
+	// Marks the calling thread as running the body of a parallel loop, for the debug checks
+	class ParallelLoopScope {
+	private:
+		const component_bitset* m_previous;
+
+	public:
+		explicit ParallelLoopScope(const component_bitset& writes);
+
+		~ParallelLoopScope();
+	};
+
+	// True within the body of a parallel loop; always false in release builds
+	static bool InParallelLoop();
+
+	// Components in Cs that are not const
+	template<typename ...Cs>
+	static component_bitset MutableBitsetOf();
+
 	entity_id GenerateId();
 
+	// First of count ids with consecutive indices
+	entity_id GenerateIds(std::size_t count);
+
+	void FreeId(entity_id id);
+
+	std::size_t GetSlot(const Entity& ent) const;
+
+	// Makes room for the entities in slots below end, once they are played back
+	void GrowSlots(std::size_t end);
+
+	// Stamps the components in Cs as changed in the current tick
+	template<typename ...Cs>
+	void StampVersions(std::size_t slot);
+
+	const TViewSet<CL>& GetViewSet(const component_bitset& mask);
+
+	void RefreshViews(const Entity& ent);
+
+	// Command buffer of the calling thread
+	CommandBuffer& GetCommandBuffer();
+
+	// Searches the command buffer of the calling thread for an entity that is not played back yet
+	void* FindNew(entity_id id, int index);
+
+	// Entity in m_entities with the given id, or nullptr when it has been removed
+	Entity* GetEntityExisting(entity_id id);
+
+	template<typename ...Cs, typename... Args>
+	CreateCommand<Cs...>& RecordCreate(Args&&... args);
+
+	template<typename ...Cs>
+	void PlayCreate(CreateCommand<Cs...>& command);
+
+	template<typename ...Cs>
+	void PlayCreateBatch(CreateBatchCommand<Cs...>& command);
+
+	void PlayInstantiate(InstantiateCommand& command);
+
+	// Emits entity_added, and component_added for each component of a played back entity
+	void EmitEntityAdded(Entity& ent);
+
 	template<typename C>
-	std::vector<C>& GetComponents();
+	void PlayAdd(AddCommand<C>& command);
+
+	template<typename C>
+	void PlayRemove(RemoveCommand<C>& command);
+
+	void PlayDestroy(DestroyCommand& command);
 
 	template<typename C>
-	std::map<entity_id, C>& GetComponentsNew();
+	void SnapshotComponents(SnapshotWriter& writer);
 
+	// Validates a component section, and adds its components to the bitsets of the live entities
 	template<typename C>
-	std::vector<C*>& GetComponentsFree();
+	bool ScanComponents(SnapshotReader& reader, const std::vector<bool>& live, std::vector<component_bitset>& bitsets);
 
 	template<typename C>
-	std::unordered_map<entity_id, int>& GetComponentsIndex();
-	
+	bool RestoreComponents(SnapshotReader& reader);
+
 	template<typename C>
-	C& GetComponentExistingImpl(entity_id id);
+	C& GetComponentExistingImpl(const Entity& ent);
 
 	template<typename C>
 	C& GetComponentNewImpl(entity_id id);
@@ -77,23 +259,12 @@ private:
 	template<typename C, typename... Args>
 	C& AddComponentExistingImpl(Entity& entity, Args&&... args);
 
-	template<typename C, typename... Args>
-	C& AddComponentNewImpl(Entity& entity, Args&&... args);
-	
-	template<typename C>
-	void RemoveComponentNewImpl(Entity& entity);
-
 	template<typename C>
 	void RemoveComponentExistingImpl(Entity& entity);
 
-	void RemoveComponentsNew(Entity& ent);
-
-	void RemoveComponentsExisting(Entity& ent);
-
 	void RemoveEntityExistingImpl(Entity& ent);
 
-	void RemoveEntityNewImpl(Entity& ent);
-
+	// Records adding a component, see CreateEntity() for the returned reference
 	template<typename C, typename... Args>
 	C& AddComponent(Entity& ent, Args&&... args);
 
@@ -103,14 +274,57 @@ private:
 public:
 	TEntityManager(TEventManagerBase<CL>& eventManager);
 
+	~TEntityManager();
+
+	void SetThreadPool(ThreadPool* threadPool);
+
+	bool IsValid(entity_id id) const;
+
 	Entity& GetEntity(entity_id id);
 
+	Entity* GetEntityOrNull(entity_id id);
+
 	template<typename F>
 	void ForEachEntity(F fun);
 
 	template<typename ...Cs, typename F>
 	void ForEachEntityWithComponents(F fun);
 
+	// Like ForEachEntityWithComponents, but spread over the thread pool in
+	// chunks of grainSize entities. Components that fun only reads are to be
+	// declared const, e.g. <Transform, const Physics>. fun may only fetch
+	// components through the entity that are declared mutable, which debug
+	// builds assert on.
+	template<typename ...Cs, typename F>
+	void ParallelForEachEntityWithComponents(F fun, std::size_t grainSize = 128);
+
+	// Returns a view over the entities having all of Cs, which is maintained
+	// as components are added and removed, instead of being searched for.
+	template<typename ...Cs>
+	View<Cs...> GetView();
+
+	// Components are stamped with the current tick when they are created or
+	// added, and when marked through MarkChanged(). Mutable access alone
+	// doesn't stamp, so systems that only write what actually changed, e.g.
+	// the Transforms of bodies that moved, leave the others unstamped. A
+	// consumer that remembers GetTick() and later asks for changes since then
+	// sees every marked change at least once, see TView::ForEachChangedSince().
+	std::uint32_t GetTick() const;
+
+	// Stamps the components Cs of an entity as changed. Within parallel loops
+	// only components declared mutable may be marked, as only those may be
+	// written.
+	template<typename ...Cs>
+	void MarkChanged(const Entity& ent);
+
+	// Tick of the last change to the component C of an entity
+	template<typename C>
+	std::uint32_t GetVersion(const Entity& ent) const;
+
+	// Entity creation, like all structural changes, is recorded in a command
+	// buffer of the calling thread and played back by Update(), so it is safe
+	// from any thread. The returned references point into the command buffer
+	// and are valid until then.
 	Entity& CreateEntity();
 
 	template<typename ...Cs>
@@ -119,9 +333,64 @@ public:
 	template<typename ...Cs>
 	Entity& CreateEntity(Cs&&...);
 
+	// Creates count entities having Cs at once, calling initFn(i, Cs&...) to set
+	// up the components of the i-th one. Storage is grown once for the batch,
+	// and instead of entity_added and component_added per entity, a single
+	// entities_added event is emitted. The entities get consecutive indices;
+	// the returned id is the first, entity i has index first.index + i. They
+	// can only be accessed after Update().
+	template<typename ...Cs, typename F>
+	entity_id CreateEntities(std::size_t count, F initFn);
+
+	// Creates an entity with copies of the components of a prefab, made in a
+	// single command, which holds only the components of the entity. Returns
+	// references to the copies of Cs, to adjust them like with CreateEntity();
+	// Cs the prefab doesn't have are added, default constructed. The components
+	// of the prefab need to be copy constructible.
+	template<typename ...Cs>
+	std::tuple<Entity&, Cs&...> Instantiate(const TPrefab<CL>& prefab);
+
 	void RemoveEntity(Entity& ent);
 
+	// Plays back the recorded structural changes, and emits their events.
+	// Must not run concurrently with anything else accessing the manager.
 	void Update();
+
+	// Registers how to save and load C in snapshots. Trivially copyable
+	// components are copied as is, unless they have a serializer; components
+	// holding pointers or handles need one. load gets a default constructed C.
+	template<typename C>
+	void SetSerializer(std::function<void(const C&, SnapshotWriter&)> save, std::function<void(SnapshotReader&, C&)> load);
+
+	// Saves all entities and their components in a binary blob. Components
+	// without a way to save them are left out, with a warning. Changes not
+	// played back by Update() yet are not included.
+	std::vector<unsigned char> Snapshot();
+
+	// Replaces all entities by the ones of a snapshot, keeping their ids. The
+	// current entities get entity_removed events, the restored ones
+	// entities_added, so systems can rebuild their runtime objects. Pending
+	// changes are dropped. Returns false if the snapshot is invalid, which
+	// leaves the world untouched, or if a serializer failed.
+	bool Restore(const std::vector<unsigned char>& snapshot);
+
+	// Optional, more expensive housekeeping after many entities were removed:
+	// trims m_entities, sorts component and view arrays by entity index for
+	// linear access, and releases spare capacity. Entity ids don't change.
+	// Same restrictions as Update().
+	void Compact();
+
+	// Gathers memory and occupancy statistics of entities, component storage,
+	// pending commands and views, along with the query statistics. Walks
+	// every container, so it's meant for periodic checks; same restrictions
+	// as Update().
+	TEntityStats<CL> GetStats();
+
+	// Starts counting the entities scanned and matched by loops anew
+	void ResetQueryStats();
+
+	// Writes GetStats() to the log
+	void LogStats();
 };
 
 } // namespace Starbase
@@ -2,10 +2,10 @@
 
 #include <functional>
 
-#include <wink/signal.hpp>
-
 #include "detail/tmp.hpp"
 #include "entity.hpp"
+#include "event_queue.hpp"
+#include "signal.hpp"
 
 namespace Starbase {
 
@@ -22,9 +22,17 @@ struct TEventList {
 	typedef std::tuple<EventTypes...> types;
 
 	template<typename EventType>
-	using signal_type_one = wink::signal<std::function<void(EventType&)>>;
+	using signal_type_one = TSignal<void(EventType&)>;
 
 	using signal_type = std::tuple<signal_type_one<EventTypes>...>;
+
+	// Listeners of queued events, getting all events of a dispatch at once
+	template<typename EventType>
+	using batch_signal_type_one = TSignal<void(const EventType* events, std::size_t count)>;
+
+	using batch_signal_type = std::tuple<batch_signal_type_one<EventTypes>...>;
+
+	using queue_type = std::tuple<TEventQueue<EventTypes>...>;
 };
 
 } // namespace Starbase
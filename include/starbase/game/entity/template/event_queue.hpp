@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace Starbase {
+
+// Events of type E emitted during a tick, stored contiguously until
+// TEventManager::Dispatch() delivers them together. Events may be queued from
+// any thread. Both buffers keep their capacity, so a warm queue doesn't
+// allocate.
+template<typename E>
+class TEventQueue {
+private:
+	std::vector<E> m_events;
+
+	// Events being dispatched; events queued meanwhile go to m_events
+	std::vector<E> m_dispatching;
+
+	std::mutex m_mutex;
+
+public:
+	TEventQueue() {}
+
+	TEventQueue(const TEventQueue&) = delete;
+	TEventQueue& operator=(const TEventQueue&) = delete;
+
+	template<typename... Args>
+	void Push(Args&&... args);
+
+	// Queues count events at once, taking the lock once
+	void Push(const E* events, std::size_t count);
+
+	// Returns the events queued so far and starts a new batch. The returned
+	// events stay valid until the next call.
+	std::vector<E>& Take();
+};
+
+} // namespace Starbase
+
+#include "detail/event_queue.inl"
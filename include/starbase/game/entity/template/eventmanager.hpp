@@ -1,12 +1,14 @@
 #pragma once
 
+#include <cstddef>
 #include <functional>
-
-#include <wink/signal.hpp>
+#include <vector>
 
 #include "entity.hpp"
 #include "component_list.hpp"
 #include "event_list.hpp"
+#include "signal.hpp"
+#include "detail/tmp.hpp"
 
 #define SB_IF_CLASS(E, c) typename std::enable_if_t<std::is_base_of<c, E>::value, c>* = nullptr
 #define SB_IF_NOT_CLASS(E, c) typename std::enable_if_t<!std::is_base_of<c, E>::value, c>* = nullptr
@@ -21,6 +23,7 @@ public:
 	struct entity_event {};
 	struct entity_added : public entity_event {};
 	struct entity_removed : public entity_event {};
+	struct entities_added : public entity_event {}; // batch of TEntityManager::CreateEntities()
 	struct component_added : public entity_event {};
 	struct component_removed : public entity_event {};
 
@@ -34,59 +37,75 @@ private:
 
 	component_signals componentAdded;
 	component_signals componentRemoved;
-	wink::signal<std::function<void(Entity& entity)>> entityAdded;
-	wink::signal<std::function<void(Entity& entity)>> entityRemoved;
+	TSignal<void(Entity& entity)> entityAdded;
+	TSignal<void(Entity& entity)> entityRemoved;
+	TSignal<void(Entity* entities, std::size_t count)> entitiesAdded;
 
 public:
+	// Listeners are called in place, see TSignal; Connect() returns a handle
+	// to disconnect them again.
+	//
 	// Due to a MSVC compiler issue, these overloads can currently not have a separate
 	// definition and declaration while using std::enable_if (error C2244)
 
 	template<typename C, typename E, SB_IF_CLASS(E, component_added)>
 	void Emit(Entity& ent, C& comp)
 	{
-		std::get<component_signal<C>>(componentAdded).emit(ent, comp);
+		std::get<component_signal<C>>(componentAdded).Emit(ent, comp);
 	}
 
 	template<typename C, typename E, SB_IF_CLASS(E, component_removed)>
 	void Emit(Entity& ent, C& comp)
 	{
-		std::get<component_signal<C>>(componentRemoved).emit(ent, comp);
+		std::get<component_signal<C>>(componentRemoved).Emit(ent, comp);
 	}
 
 	template<typename E, SB_IF_CLASS(E, entity_added)>
 	void Emit(Entity& ent)
 	{
-		entityAdded.emit(ent);
+		entityAdded.Emit(ent);
 	}
 
 	template<typename E, SB_IF_CLASS(E, entity_removed)>
 	void Emit(Entity& ent)
 	{
-		entityRemoved.emit(ent);
+		entityRemoved.Emit(ent);
+	}
+
+	template<typename E, SB_IF_CLASS(E, entities_added)>
+	void Emit(Entity* entities, std::size_t count)
+	{
+		entitiesAdded.Emit(entities, count);
 	}
 
 	template<typename E, SB_IF_CLASS(E, entity_added), typename... Args>
-	void Connect(Args&&... args)
+	SignalConnection Connect(Args&&... args)
+	{
+		return entityAdded.Connect(std::forward<Args>(args)...);
+	}
+
+	template<typename E, SB_IF_CLASS(E, entities_added), typename... Args>
+	SignalConnection Connect(Args&&... args)
 	{
-		entityAdded.connect(std::forward<Args>(args)...);
+		return entitiesAdded.Connect(std::forward<Args>(args)...);
 	}
 
 	template<typename E, SB_IF_CLASS(E, entity_removed), typename... Args>
-	void Connect(Args&&... args)
+	SignalConnection Connect(Args&&... args)
 	{
-		entityRemoved.connect(std::forward<Args>(args)...);
+		return entityRemoved.Connect(std::forward<Args>(args)...);
 	}
 
 	template<typename C, typename E, SB_IF_CLASS(E, component_added), typename... Args>
-	void Connect(Args&&... args)
+	SignalConnection Connect(Args&&... args)
 	{
-		std::get<component_signal<C>>(componentAdded).connect(std::forward<Args>(args)...);
+		return std::get<component_signal<C>>(componentAdded).Connect(std::forward<Args>(args)...);
 	}
 
 	template<typename C, typename E, SB_IF_CLASS(E, component_removed), typename... Args>
-	void Connect(Args&&... args)
+	SignalConnection Connect(Args&&... args)
 	{
-		std::get<component_signal<C>>(componentRemoved).connect(std::forward<Args>(args)...);
+		return std::get<component_signal<C>>(componentRemoved).Connect(std::forward<Args>(args)...);
 	}
 };
 
@@ -97,25 +116,80 @@ class TEventManager : public TEventManagerBase<CL> {
 
     using event_list_signals = typename EL::signal_type;
 
+	template<typename E>
+	using event_list_batch_signal = typename EL::template batch_signal_type_one<E>;
+
 	event_list_signals signals;
+	typename EL::batch_signal_type batchSignals;
+	typename EL::queue_type queues;
 
 public:
 	using entity_event = typename TEventManagerBase<CL>::entity_event;
 	using entity_added = typename TEventManagerBase<CL>::entity_added;
 	using entity_removed = typename TEventManagerBase<CL>::entity_removed;
+	using entities_added = typename TEventManagerBase<CL>::entities_added;
     using component_added = typename TEventManagerBase<CL>::component_added;
     using component_removed = typename TEventManagerBase<CL>::component_removed;
 
 	template<typename E, SB_IF_NOT_CLASS(E, entity_event), typename... Args>
     void Emit(Args&&... args)
 	{
-        std::get<event_list_signal<E>>(signals).emit(std::forward<Args>(args)...);
+        std::get<event_list_signal<E>>(signals).Emit(std::forward<Args>(args)...);
 	}
 
     template<typename E, SB_IF_NOT_CLASS(E, entity_event), typename... Args>
-    void Connect(Args&&... args)
+    SignalConnection Connect(Args&&... args)
+	{
+        return std::get<event_list_signal<E>>(signals).Connect(std::forward<Args>(args)...);
+	}
+
+	// Queues an event, constructed from args, for the next Dispatch() instead
+	// of emitting it right away. Safe from any thread; events should refer to
+	// entities by entity_id, as they are delivered after the loop that queued
+	// them.
+	template<typename E, SB_IF_NOT_CLASS(E, entity_event), typename... Args>
+	void Queue(Args&&... args)
 	{
-        std::get<event_list_signal<E>>(signals).connect(std::forward<Args>(args)...);
+		std::get<TEventQueue<E>>(queues).Push(std::forward<Args>(args)...);
+	}
+
+	// Queues count events at once
+	template<typename E, SB_IF_NOT_CLASS(E, entity_event)>
+	void QueueBatch(const E* events, std::size_t count)
+	{
+		std::get<TEventQueue<E>>(queues).Push(events, count);
+	}
+
+	// Listens to the queued events of type E, getting every dispatched batch
+	// as one array
+	template<typename E, SB_IF_NOT_CLASS(E, entity_event), typename... Args>
+	SignalConnection ConnectBatch(Args&&... args)
+	{
+		return std::get<event_list_batch_signal<E>>(batchSignals).Connect(std::forward<Args>(args)...);
+	}
+
+	// Delivers the queued events, type by type: first to the batch listeners,
+	// then one by one to the listeners of Connect(). Events queued by listeners
+	// wait for the next call. Meant for sync points, where no other thread
+	// accesses what listeners touch.
+	void Dispatch()
+	{
+		TMP::ForEach<typename EL::types>([&](auto type_holder) {
+			(void)type_holder; using E = typename decltype(type_holder)::type;
+
+			std::vector<E>& events = std::get<TEventQueue<E>>(queues).Take();
+			if (events.empty())
+				return;
+
+			std::get<event_list_batch_signal<E>>(batchSignals).Emit(events.data(), events.size());
+
+			event_list_signal<E>& signal = std::get<event_list_signal<E>>(signals);
+			if (!signal.Empty()) {
+				for (E& event : events) {
+					signal.Emit(event);
+				}
+			}
+		});
 	}
 
     // We must redefine Connect overloads from the base class, otherwise they
@@ -123,27 +197,33 @@ public:
     // does not seem to work in MSVC (error C2672)
 	
 	template<typename E, SB_IF_CLASS(E, entity_added), typename... Args>
-	void Connect(Args&&... args)
+	SignalConnection Connect(Args&&... args)
 	{
-        TEventManagerBase<CL>::template Connect<E>(std::forward<Args>(args)...);
+        return TEventManagerBase<CL>::template Connect<E>(std::forward<Args>(args)...);
 	}
 
 	template<typename E, SB_IF_CLASS(E, entity_removed), typename... Args>
-	void Connect(Args&&... args)
+	SignalConnection Connect(Args&&... args)
+	{
+        return TEventManagerBase<CL>::template Connect<E>(std::forward<Args>(args)...);
+	}
+
+	template<typename E, SB_IF_CLASS(E, entities_added), typename... Args>
+	SignalConnection Connect(Args&&... args)
 	{
-        TEventManagerBase<CL>::template Connect<E>(std::forward<Args>(args)...);
+        return TEventManagerBase<CL>::template Connect<E>(std::forward<Args>(args)...);
 	}
 
 	template<typename C, typename E, SB_IF_CLASS(E, component_added), typename... Args>
-	void Connect(Args&&... args)
+	SignalConnection Connect(Args&&... args)
 	{
-		TEventManagerBase<CL>::template Connect<C, E>(std::forward<Args>(args)...);
+		return TEventManagerBase<CL>::template Connect<C, E>(std::forward<Args>(args)...);
 	}
 
 	template<typename C, typename E, SB_IF_CLASS(E, component_removed), typename... Args>
-	void Connect(Args&&... args)
+	SignalConnection Connect(Args&&... args)
 	{
-		TEventManagerBase<CL>::template Connect<C, E>(std::forward<Args>(args)...);
+		return TEventManagerBase<CL>::template Connect<C, E>(std::forward<Args>(args)...);
 	}
 };
 
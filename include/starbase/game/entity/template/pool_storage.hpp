@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <tuple>
+
+#include "component_list.hpp"
+#include "component_pool.hpp"
+#include "entity.hpp"
+#include "entity_stats.hpp"
+
+namespace Starbase {
+
+// Default component storage of TEntityManager: one sparse set pool per component type.
+// Queries iterate the densely packed components of the smallest involved pool.
+template<typename CL>
+class TPoolStorage {
+public:
+	using Entity = TEntity<CL>;
+
+	using component_bitset = typename Entity::component_bitset;
+
+private:
+	typename CL::pool_type m_pools;
+
+public:
+	TPoolStorage() {}
+
+	TPoolStorage(const TPoolStorage&) = delete;
+	TPoolStorage& operator=(const TPoolStorage&) = delete;
+
+	// Prepares storage for an entity that is about to receive its initial components
+	void Insert(std::size_t slot, const component_bitset& bitset);
+
+	// Makes room for count entities with the components in bitset, in slots below slotCount
+	void Reserve(const component_bitset& bitset, std::size_t slotCount, std::size_t count);
+
+	// Constructs one of the initial components of an inserted entity
+	template<typename C, typename... Args>
+	C& Emplace(std::size_t slot, Args&&... args);
+
+	// Adds a component to an entity currently owning the components in bitset
+	template<typename C, typename... Args>
+	C& Add(std::size_t slot, const component_bitset& bitset, Args&&... args);
+
+	template<typename C>
+	C& Get(std::size_t slot);
+
+	// Removes a component from an entity, which keeps the components in bitset
+	template<typename C>
+	void Remove(std::size_t slot, const component_bitset& bitset);
+
+	// Removes all components of an entity
+	void Erase(std::size_t slot, const component_bitset& bitset);
+
+	// Sorts every pool by slot and releases spare capacity
+	void Compact();
+
+	// Returns the number of entities looked at
+	template<typename ...Cs, typename F>
+	std::size_t ForEach(const std::vector<Entity>& entities, F fun);
+
+	// Calls fun(slots, components, count) for each contiguous array of C
+	template<typename C, typename F>
+	void ForEachArray(F fun);
+
+	template<typename C>
+	ComponentStats GetStats() const;
+
+	// Memory not belonging to a single component type
+	std::size_t GetSharedBytes() const;
+
+	template<typename C>
+	TComponentPool<C>& GetPool();
+};
+
+} // namespace Starbase
+
+#include "detail/pool_storage.inl"
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <tuple>
+
+#include "entity.hpp"
+
+namespace Starbase {
+
+// Template of an entity: the components it starts with, and their values.
+// Built once, e.g. with the resources of its components resolved, and
+// copied into every entity made by TEntityManager::Instantiate().
+template<typename CL>
+class TPrefab {
+public:
+	using component_bitset = typename TEntity<CL>::component_bitset;
+
+private:
+	component_bitset m_bitset;
+
+	// One of each component type, those not in m_bitset stay default constructed
+	typename CL::types m_components;
+
+public:
+	TPrefab();
+
+	// Adds C to the prefab, or replaces its value
+	template<typename C>
+	C& Set(C component);
+
+	template<typename C>
+	bool Has() const;
+
+	template<typename C>
+	const C& Get() const;
+
+	const component_bitset& GetBitset() const
+	{ return m_bitset; }
+
+	const typename CL::types& GetComponents() const
+	{ return m_components; }
+};
+
+} // namespace Starbase
+
+#include "detail/prefab.inl"
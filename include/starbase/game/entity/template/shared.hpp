@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace Starbase {
+
+// Deduplicated values of type T, addressed by a small index. There is one
+// table per type, like the string table of IDs. Values are never removed,
+// so the table is meant for the few distinct values entities have in common,
+// e.g. their model resources. T needs std::hash and operator==.
+template<typename T>
+class TSharedTable {
+public:
+	static constexpr std::size_t BLOCK_SIZE = 256;
+	static constexpr std::size_t MAX_BLOCKS = 256;
+
+private:
+	// Values are stored in blocks that never move, so reads need no lock
+	std::array<std::unique_ptr<T[]>, MAX_BLOCKS> m_blocks;
+	std::atomic<std::uint32_t> m_count;
+
+	std::unordered_map<T, std::uint32_t> m_indices;
+
+	// Guards m_indices and adding values
+	std::mutex m_mutex;
+
+	TSharedTable();
+
+public:
+	static TSharedTable& Instance();
+
+	// Index of value, adding it if it's new. Index 0 is the default constructed T.
+	std::uint32_t Intern(const T& value);
+
+	const T& Get(std::uint32_t index) const
+	{ return m_blocks[index / BLOCK_SIZE][index % BLOCK_SIZE]; }
+
+	std::size_t Size() const
+	{ return m_count.load(std::memory_order_acquire); }
+};
+
+// Component field referencing a value of a TSharedTable. Copying it copies a
+// 4 byte index, instead of the value, e.g. a ResourcePtr with its refcount.
+// Entities sharing a value have the same index, so they can be grouped by it.
+template<typename T>
+class TShared {
+private:
+	std::uint32_t m_index;
+
+public:
+	TShared()
+		: m_index(0)
+	{}
+
+	explicit TShared(const T& value)
+		: m_index(TSharedTable<T>::Instance().Intern(value))
+	{}
+
+	const T& operator*() const
+	{ return TSharedTable<T>::Instance().Get(m_index); }
+
+	const T* operator->() const
+	{ return &**this; }
+
+	std::uint32_t Index() const
+	{ return m_index; }
+
+	bool operator==(const TShared& other) const
+	{ return m_index == other.m_index; }
+
+	bool operator!=(const TShared& other) const
+	{ return m_index != other.m_index; }
+};
+
+} // namespace Starbase
+
+#include "detail/shared.inl"
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace Starbase {
+
+// Handle to a listener connected to a TSignal, for disconnecting it. Must not
+// outlive the signal. Copies refer to the same listener.
+class SignalConnection {
+private:
+	void* m_signal;
+	void (*m_disconnect)(void*, std::uint32_t);
+	std::uint32_t m_id;
+
+public:
+	SignalConnection()
+		: m_signal(nullptr)
+		, m_disconnect(nullptr)
+		, m_id(0)
+	{}
+
+	SignalConnection(void* signal, void (*disconnect)(void*, std::uint32_t), std::uint32_t id)
+		: m_signal(signal)
+		, m_disconnect(disconnect)
+		, m_id(id)
+	{}
+
+	bool Connected() const
+	{ return m_signal != nullptr; }
+
+	// Removes the listener from the signal; does nothing when already done
+	void Disconnect()
+	{
+		if (m_signal) {
+			m_disconnect(m_signal, m_id);
+			m_signal = nullptr;
+		}
+	}
+};
+
+template<typename Signature>
+class TDelegate;
+
+// Callable stored in place, without allocating: the callable is constructed in
+// an inline buffer and called through a function instantiated for its type,
+// so lambdas get inlined there rather than wrapped like in std::function.
+// Callables bigger than INLINE_BYTES are rejected at compile time; capture a
+// pointer to the state instead.
+template<typename R, typename ...Args>
+class TDelegate<R(Args...)> {
+public:
+	static constexpr std::size_t INLINE_BYTES = 4 * sizeof(void*);
+
+private:
+	using storage_type = typename std::aligned_storage<INLINE_BYTES, alignof(std::max_align_t)>::type;
+
+	// Moves the callable from src to the uninitialized dest and destroys src,
+	// or destroys dest when src is nullptr
+	using manage_function = void (*)(void* dest, void* src);
+	using invoke_function = R (*)(void* storage, Args... args);
+
+	storage_type m_storage;
+	invoke_function m_invoke;
+
+	// nullptr for trivially copyable callables, which are moved by copying the buffer
+	manage_function m_manage;
+
+	template<typename F>
+	static R Invoke(void* storage, Args... args);
+
+	template<typename F>
+	static void Manage(void* dest, void* src);
+
+	void Reset();
+
+public:
+	TDelegate();
+
+	template<typename F, typename = std::enable_if_t<!std::is_same<std::decay_t<F>, TDelegate>::value>>
+	TDelegate(F&& fun);
+
+	TDelegate(TDelegate&& other);
+
+	TDelegate& operator=(TDelegate&& other);
+
+	TDelegate(const TDelegate&) = delete;
+	TDelegate& operator=(const TDelegate&) = delete;
+
+	~TDelegate();
+
+	explicit operator bool() const
+	{ return m_invoke != nullptr; }
+
+	R operator()(Args... args) const;
+};
+
+template<typename Signature>
+class TSignal;
+
+// Listeners of an event, kept in one contiguous array and called in the order
+// they were connected. Listeners may connect and disconnect others, or
+// themselves, while the signal is emitted: disconnected ones are skipped,
+// connected ones are called from the next Emit() on. Not thread-safe.
+template<typename ...Args>
+class TSignal<void(Args...)> {
+public:
+	using delegate_type = TDelegate<void(Args...)>;
+
+private:
+	struct Slot {
+		delegate_type delegate;
+		std::uint32_t id; // 0 once disconnected
+	};
+
+	std::vector<Slot> m_slots;
+
+	// Listeners connected while emitting, added once the outermost Emit() returns
+	std::vector<Slot> m_pending;
+
+	std::uint32_t m_nextId;
+	int m_emitting;
+
+	// Whether listeners were disconnected while emitting
+	bool m_disconnected;
+
+	static void DisconnectFromHandle(void* signal, std::uint32_t id);
+
+	void Disconnect(std::uint32_t id);
+
+	// Applies the connections and disconnections made while emitting
+	void Flush();
+
+public:
+	TSignal();
+
+	// Connections refer to the signal, so it stays in place
+	TSignal(const TSignal&) = delete;
+	TSignal& operator=(const TSignal&) = delete;
+
+	template<typename F>
+	SignalConnection Connect(F&& fun);
+
+	void Emit(Args... args);
+
+	std::size_t Size() const
+	{ return m_slots.size() + m_pending.size(); }
+
+	bool Empty() const
+	{ return Size() == 0; }
+};
+
+} // namespace Starbase
+
+#include "detail/signal.inl"
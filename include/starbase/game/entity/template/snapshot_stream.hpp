@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace Starbase {
+
+// Appends binary data to a snapshot blob, see TEntityManager::Snapshot()
+class SnapshotWriter {
+private:
+	std::vector<unsigned char>& m_data;
+
+public:
+	explicit SnapshotWriter(std::vector<unsigned char>& data)
+		: m_data(data)
+	{}
+
+	std::size_t Size() const
+	{ return m_data.size(); }
+
+	void WriteBytes(const void* data, std::size_t size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		m_data.insert(m_data.end(), bytes, bytes + size);
+	}
+
+	template<typename T>
+	void Write(const T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be written as is");
+		WriteBytes(&value, sizeof(T));
+	}
+
+	// Overwrites a value written before, e.g. a size that wasn't known yet
+	template<typename T>
+	void WriteAt(std::size_t offset, const T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be written as is");
+		std::memcpy(&m_data[offset], &value, sizeof(T));
+	}
+};
+
+// Reads binary data from a snapshot blob, see TEntityManager::Restore(). Reads
+// past the end fail, and mark the reader as failed.
+class SnapshotReader {
+private:
+	const unsigned char* m_data;
+	std::size_t m_size;
+	std::size_t m_offset;
+	bool m_failed;
+
+public:
+	SnapshotReader(const unsigned char* data, std::size_t size)
+		: m_data(data)
+		, m_size(size)
+		, m_offset(0)
+		, m_failed(false)
+	{}
+
+	bool Failed() const
+	{ return m_failed; }
+
+	std::size_t Offset() const
+	{ return m_offset; }
+
+	void Seek(std::size_t offset)
+	{
+		if (offset > m_size)
+			m_failed = true;
+		else
+			m_offset = offset;
+	}
+
+	// Returns the next size bytes and moves past them, or nullptr if there are not enough left
+	const unsigned char* Skip(std::size_t size)
+	{
+		if (m_failed || size > m_size - m_offset) {
+			m_failed = true;
+			return nullptr;
+		}
+
+		const unsigned char* bytes = m_data + m_offset;
+		m_offset += size;
+		return bytes;
+	}
+
+	bool ReadBytes(void* dest, std::size_t size)
+	{
+		const unsigned char* bytes = Skip(size);
+		if (bytes)
+			std::memcpy(dest, bytes, size);
+		return bytes != nullptr;
+	}
+
+	template<typename T>
+	bool Read(T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be read as is");
+		return ReadBytes(&value, sizeof(T));
+	}
+};
+
+} // namespace Starbase
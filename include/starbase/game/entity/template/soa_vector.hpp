@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <array>
+#include <type_traits>
+#include <vector>
+
+namespace Starbase {
+
+// Vector of T stored as structure of arrays: T is seen as a sequence of
+// Scalars, and the i-th Scalar of every element is kept in its own lane.
+// E.g. a T of { pos.x, pos.y, rot } gives the lanes pos.x[], pos.y[] and
+// rot[], which kernels can process several elements at a time with SIMD.
+// Elements are read and written whole, through a proxy reference.
+template<typename T, typename Scalar = float>
+class TSoAVector {
+public:
+	static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be split into lanes");
+	static_assert(sizeof(T) % sizeof(Scalar) == 0, "T must consist of Scalars only");
+
+	static constexpr std::size_t LANES = sizeof(T) / sizeof(Scalar);
+
+	// Lane of the member at offset, e.g. LaneOf(offsetof(T, rot))
+	static constexpr std::size_t LaneOf(std::size_t offset)
+	{ return offset / sizeof(Scalar); }
+
+	class Reference {
+	private:
+		TSoAVector& m_vector;
+		std::size_t m_index;
+
+	public:
+		Reference(TSoAVector& vector, std::size_t index)
+			: m_vector(vector), m_index(index)
+		{}
+
+		operator T() const
+		{ return m_vector.Get(m_index); }
+
+		Reference& operator=(const T& value)
+		{ m_vector.Set(m_index, value); return *this; }
+	};
+
+private:
+	std::array<std::vector<Scalar>, LANES> m_lanes;
+
+public:
+	std::size_t Size() const
+	{ return m_lanes[0].size(); }
+
+	void Clear();
+
+	void Reserve(std::size_t capacity);
+
+	void Resize(std::size_t size);
+
+	void PushBack(const T& value);
+
+	// Gathers the element from the lanes
+	T Get(std::size_t index) const;
+
+	// Scatters the element to the lanes
+	void Set(std::size_t index, const T& value);
+
+	Reference operator[](std::size_t index)
+	{ return Reference(*this, index); }
+
+	T operator[](std::size_t index) const
+	{ return Get(index); }
+
+	Scalar* Lane(std::size_t lane)
+	{ return m_lanes[lane].data(); }
+
+	const Scalar* Lane(std::size_t lane) const
+	{ return m_lanes[lane].data(); }
+};
+
+} // namespace Starbase
+
+#include "detail/soa_vector.inl"
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "entity.hpp"
+
+namespace Starbase {
+
+// Slots of the entities having all components of a mask. Kept up to date
+// by TEntityManager whenever it adds or removes components or entities.
+template<typename CL>
+class TViewSet {
+public:
+	using component_bitset = typename TEntity<CL>::component_bitset;
+
+private:
+	component_bitset m_mask;
+	std::vector<std::uint32_t> m_slots;
+	std::vector<std::int32_t> m_positions;
+
+	void Insert(std::size_t slot);
+
+	void Erase(std::size_t slot);
+
+public:
+	explicit TViewSet(const component_bitset& mask)
+		: m_mask(mask)
+	{}
+
+	const component_bitset& GetMask() const
+	{ return m_mask; }
+
+	const std::vector<std::uint32_t>& GetSlots() const
+	{ return m_slots; }
+
+	// Adds or removes the entity in slot, depending on whether bitset matches the mask
+	void Refresh(std::size_t slot, const component_bitset& bitset);
+
+	// Sorts the slots, so views iterate storage in order
+	void Compact();
+
+	std::size_t BytesHeld() const
+	{ return m_slots.capacity() * sizeof(std::uint32_t) + m_positions.capacity() * sizeof(std::int32_t); }
+};
+
+// Persistent query over the entities having all of Cs, see TEntityManager::GetView()
+template<typename CL, typename ...Cs>
+class TView {
+private:
+	TEntityManager<CL>& m_entityManager;
+	const TViewSet<CL>& m_set;
+
+public:
+	TView(TEntityManager<CL>& entityManager, const TViewSet<CL>& set)
+		: m_entityManager(entityManager)
+		, m_set(set)
+	{}
+
+	std::size_t Size() const
+	{ return m_set.GetSlots().size(); }
+
+	// Components in Cs may be const, for read-only access
+	template<typename F>
+	void ForEach(F fun);
+
+	// ForEach over the entities whose component C, one of Cs, changed at or
+	// after tick, see TEntityManager::GetTick() and MarkChanged().
+	template<typename C, typename F>
+	void ForEachChangedSince(std::uint32_t tick, F fun);
+
+	// ForEach spread over the entity manager's thread pool, in chunks of grainSize
+	// entities, see TEntityManager::ParallelForEachEntityWithComponents()
+	template<typename F>
+	void ParallelForEach(F fun, std::size_t grainSize);
+};
+
+} // namespace Starbase
+
+#include "detail/view.inl"
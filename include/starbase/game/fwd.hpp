@@ -4,6 +4,7 @@ namespace Starbase {
 
 	struct Physics;
     struct Transform;
+	struct Scale;
 	struct ShipControls;
 	struct AutoDestruct;
     
@@ -3,12 +3,15 @@
 #include <memory>
 
 #include <starbase/game/id.hpp>
+#include <starbase/game/thread_pool.hpp>
 #include <starbase/game/fs/ifilesystem.hpp>
 #include <starbase/game/resource/resourceloader.hpp>
 #include <starbase/game/entity/entity.hpp>
 #include <starbase/game/entity/entitymanager.hpp>
 #include <starbase/game/entity/eventmanager.hpp>
+#include <starbase/game/entity/prefab_registry.hpp>
 
+#include <starbase/game/system/system_scheduler.hpp>
 #include <starbase/game/system/physics_system.hpp>
 #include <starbase/game/system/shipcontrols_system.hpp>
 #include <starbase/game/system/autodestruct_system.hpp>
@@ -20,16 +23,35 @@ protected:
 	IFilesystem& m_filesystem;
 	ResourceLoader m_resourceLoader;
 	EventManager m_eventManager;
+	ThreadPool m_threadPool;
 	EntityManager m_entityManager;
+	PrefabRegistry m_prefabRegistry;
 
 	PhysicsSystem m_physicsSystem;
 	ShipControlsSystem m_shipControlsSystem;
 	AutoDestructSystem m_autoDestructSystem;
 
+	SystemScheduler m_systemScheduler;
+
 	int m_step;
 
 	static constexpr id_t TEST_SPACE = IDC("TEST_SPACE");
 
+	// Collision types of the physics prefabs
+	static constexpr id_t COLLISION_BULLET = IDC("BULLET");
+	static constexpr id_t COLLISION_SHIP = IDC("SHIP");
+
+	// Steps between compaction passes of the entity manager
+	static constexpr int COMPACT_INTERVAL = 60 * 60;
+
+	// Steps between dumps of the entity manager statistics
+	static constexpr int STATS_INTERVAL = 60 * 10;
+
+	void AddSystems();
+
+	// Snapshot serializers of the components holding runtime objects
+	void AddSerializers();
+
 public:
 	Game(IFilesystem& filesystem);
 
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Starbase {
+
+// Mutual gravity of a set of bodies, where two bodies attract each other
+// with G * m1 * m2 / d^2. Uses Barnes-Hut: bodies are sorted into a quadtree,
+// and a cell that looks small from a body, i.e. its size divided by its
+// distance is below theta, acts on it as a single mass at its center of
+// mass. That takes O(n log n) instead of the O(n^2) of summing all pairs.
+class GravitySolver {
+public:
+	struct Params {
+		double gravityConstant;
+
+		// Opening angle; smaller is more precise and slower
+		double theta;
+
+		// Sums all pairs instead of using the tree, to validate the approximation
+		bool exact;
+
+		Params() : gravityConstant(20.0), theta(0.5), exact(false) {}
+	};
+
+private:
+	// Cells deeper than this keep all their bodies in a list, e.g. bodies
+	// at the same position, which can't be told apart by splitting
+	static constexpr int MAX_DEPTH = 32;
+
+	struct Node {
+		// Square cell, by its center and half of its size
+		double centerX, centerY;
+		double halfSize;
+
+		double mass;
+		double massX, massY; // center of mass
+
+		// Index of the first of the four children, 0 for leaves
+		std::uint32_t children;
+
+		// First body of a leaf, -1 if the leaf is empty
+		std::int32_t body;
+
+		int depth;
+	};
+
+	Params m_params;
+
+	// Rebuilt every Compute(), but the memory is kept
+	std::vector<Node> m_nodes;
+
+	// Next body in the same leaf, -1 for the last one
+	std::vector<std::int32_t> m_next;
+
+	std::vector<std::uint32_t> m_stack;
+
+	void Build(const double* x, const double* y, std::size_t count);
+
+	void Insert(std::int32_t body, const double* x, const double* y);
+
+	void Split(std::uint32_t node, const double* x, const double* y);
+
+	// Sums masses bottom-up; children are always after their parent
+	void AccumulateMass(const double* x, const double* y, const double* mass);
+
+	void ComputeTree(const double* x, const double* y, const double* mass, std::size_t count, double* forceX, double* forceY);
+
+public:
+	void SetParams(const Params& params)
+	{ m_params = params; }
+
+	const Params& GetParams() const
+	{ return m_params; }
+
+	// Computes the force every body gets from all the others. Bodies at the
+	// same position don't attract each other.
+	void Compute(const double* x, const double* y, const double* mass, std::size_t count, double* forceX, double* forceY);
+
+	// Sums all pairs, as Params::exact does
+	static void ComputeExact(double gravityConstant, const double* x, const double* y, const double* mass, std::size_t count, double* forceX, double* forceY);
+};
+
+// Sums the pull of count attractors on each of n bodies, like GravitySolver
+// without G and the mass of the body: pull[i] = sum of m_k * r / |r|^3. Works
+// on single lanes of a TSoAVector, four bodies at a time with SSE where
+// available. Attractors at the position of a body don't pull on it.
+void ComputeAttractorPull(const float* x, const float* y, std::size_t n,
+	const float* attractorX, const float* attractorY, const float* attractorMass, std::size_t count,
+	float* pullX, float* pullY);
+
+} // namespace Starbase
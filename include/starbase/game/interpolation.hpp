@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+
+namespace Starbase {
+
+// Computes out[i] = prev[i] + (cur[i] - prev[i]) * alpha for count values, four
+// at a time with SSE where available. Works on single lanes of a TSoAVector,
+// e.g. the positions of the previous and current step. out may alias cur or prev.
+void InterpolateLanes(const float* prev, const float* cur, float alpha, float* out, std::size_t count);
+
+} // namespace Starbase
@@ -33,6 +33,9 @@ struct ModelFiles {
 
 std::unique_ptr<ModelFiles> GetModelFiles(IFilesystem& fs, const std::string& path);
 
+// Reads only the yml config of a model, without parsing its svg
+bool GetModelConfig(IFilesystem& fs, const std::string& path, YAML::Node& cfg);
+
 glm::vec2 GetShapeCenter(const NSVGshape* shape);
 
 glm::mat4 GetTransformMatrix(const ModelFiles& mf);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cassert>
+#include <functional>
 #include <memory>
 
 #include <starbase/game/id.hpp>
@@ -53,6 +54,10 @@ public:
 		return m_id;
 	}
 
+	// Like Id(), but -1 for an uninitialized pointer instead of asserting
+	id_t IdOrInvalid() const
+	{ return m_id; }
+
 	const std::string& GetName() const
 	{
 #ifndef NDEBUG
@@ -63,4 +68,21 @@ public:
 	}
 };
 
-} // namespace Starbase
\ No newline at end of file
+// Resource pointers are equal when they refer to the same resource id, e.g. for TShared
+template<typename T>
+static inline bool operator==(const ResourcePtr<T>& a, const ResourcePtr<T>& b)
+{
+	return a.IdOrInvalid() == b.IdOrInvalid();
+}
+
+} // namespace Starbase
+
+namespace std {
+
+template<typename T>
+struct hash<Starbase::ResourcePtr<T>> {
+	std::size_t operator()(const Starbase::ResourcePtr<T>& ptr) const
+	{ return std::hash<Starbase::id_t>()(ptr.IdOrInvalid()); }
+};
+
+} // namespace std
\ No newline at end of file
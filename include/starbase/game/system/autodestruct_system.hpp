@@ -13,7 +13,7 @@ private:
 public:
 	AutoDestructSystem(EntityManager& entityManager) : m_entityManager(entityManager) {}
 
-	void Update(int step, Entity& ent, AutoDestruct& autoDestruct);
+	void Update(int step, Entity& ent, const AutoDestruct& autoDestruct);
 };
 
 } // namespace Starbase
@@ -1,31 +1,144 @@
 #pragma once
 
+#include <memory>
+#include <utility>
 #include <vector>
 #include <unordered_map>
 
 #include <starbase/game/id.hpp>
+#include <starbase/game/thread_pool.hpp>
 #include <starbase/game/entity/entity.hpp>
+#include <starbase/game/entity/entitymanager.hpp>
 #include <starbase/game/entity/eventmanager.hpp>
+#include <starbase/game/entity/template/soa_vector.hpp>
 #include <starbase/game/component/physics.hpp>
 #include <starbase/game/component/transform.hpp>
+#include <starbase/game/component/scale.hpp>
 
 #include <starbase/game/chipmunk_safe.hpp>
+#include <starbase/game/gravity.hpp>
 
 namespace Starbase {
 
 class PhysicsSystem {
+public:
+	struct SpaceParams {
+		// Creates cpHastySpaces, whose solver runs on several threads; pays
+		// off for spaces with many touching bodies
+		bool hasty;
+
+		// Solver threads of hasty spaces, 0 for one per core
+		unsigned long threads;
+
+		// Solver iterations per step; more are stiffer and slower
+		int iterations;
+
+		SpaceParams() : hasty(false), threads(0), iterations(10) {}
+	};
+
 private:
+	struct GravityPoint {
+		float x, y, mass;
+	};
+
+	// Bodies of a space and their state, gathered for gravity. Attractors
+	// pull on each other through the solver, and on all other bodies through
+	// ComputeAttractorPull(); the other bodies don't pull at all.
+	struct GravityBodies {
+		std::vector<cpBody*> attractors;
+		std::vector<double> x, y, mass;
+		std::vector<double> forceX, forceY;
+		TSoAVector<GravityPoint> attractorPoints;
+
+		std::vector<cpBody*> particles;
+		TSoAVector<GravityPoint> particlePoints;
+		std::vector<float> pullX, pullY;
+	};
+
+	// Everything a space needs during its step, so spaces can be stepped
+	// concurrently
+	struct Space {
+		std::shared_ptr<cpSpace> space;
+		PhysicsSystem* system;
+
+		// Stepped with cpHastySpaceStep()
+		bool hasty;
+
+		// Solver threads last set on a hasty space
+		unsigned long threads;
+
+		// Filled by the collision handlers during a step, and queued as one
+		// batch after it
+		std::vector<CollisionEvent> contacts;
+
+		GravitySolver gravity;
+		GravityBodies gravityBodies;
+	};
+
 	EventManager& m_eventManager;
+	EntityManager& m_entityManager;
+
+	SpaceParams m_spaceParams;
+
+	// Nodes of the map don't move, so the collision handlers point at them
+	std::unordered_map<id_t, Space> m_spaces;
+
+	// Collision type pairs reported as CollisionEvents, in every space
+	std::vector<std::pair<id_t, id_t>> m_collisionPairs;
+
+	struct BodyEntity {
+		entity_id entity;
+		bool attractor; // see Physics::attractor
+	};
+
+	// Entity of every body, for the collision handlers, gravity and the
+	// Transform sync
+	std::unordered_map<const cpBody*, BodyEntity> m_bodyEntities;
+
+	GravitySolver::Params m_gravityParams;
+
+	// Bodies at least this heavy are attractors even when not flagged
+	cpFloat m_attractorMass;
 
-	std::unordered_map<id_t, std::shared_ptr<cpSpace>> m_spaces;
+	// Steps the spaces in parallel when set
+	ThreadPool* m_threadPool;
+
+	// Spaces of the current step, one job each
+	std::vector<Space*> m_spaceJobs;
 
 	void InitSpace(id_t spaceId);
 
+	// Solver threads of hasty spaces for the next step. Spaces stepped in
+	// parallel share the threads of the pool, at least one each.
+	unsigned long HastyThreads(bool parallel) const;
+
+	static void SetHastyThreads(Space& space, unsigned long threads);
+
+	void InstallCollisionHandler(Space& space, id_t typeA, id_t typeB);
+
+	// Records a contact of an arbiter of a space, if both bodies belong to
+	// entities; returns its index in the contacts of the space, or -1
+	static int AddContact(Space& space, cpArbiter* arb, CollisionEvent::Phase phase);
+
+	static cpBool CollisionBegin(cpArbiter* arb, cpSpace* cpspace, cpDataPointer data);
+
+	static void CollisionPostSolve(cpArbiter* arb, cpSpace* cpspace, cpDataPointer data);
+
+	static void CollisionSeparate(cpArbiter* arb, cpSpace* cpspace, cpDataPointer data);
+
 	void InitBody(const Entity& ent, Transform& transf, Physics& phys);
 
-	void ApplyGravity(cpSpace* space, float dt);
+	void ApplyGravity(Space& space, float dt) const;
+
+	// Copies the position of the body to the Transform, and marks it changed,
+	// if the body moved since the last sync
+	static void SyncTransform(const Entity& ent, Transform& transf, const cpBody* body);
+
+	// Only touches the space and the Transforms of the entities of its bodies,
+	// which belong to no other space, and reads m_bodyEntities
+	void StepSpace(Space& space, float dt) const;
 public:
-	PhysicsSystem(EventManager& eventManager);
+	PhysicsSystem(EventManager& eventManager, EntityManager& entityManager);
 
 	~PhysicsSystem();
 
@@ -33,9 +146,42 @@ public:
 
 	void PhysicsRemoved(const Entity& ent, Transform& transf, Physics& physics);
 
-	void Simulate(float dt);
+	// Reports shapes of the collision types typeA and typeB starting and
+	// ceasing to touch, see Physics::collisionType. The contacts of a step are
+	// queued as a batch of CollisionEvents after it, and dispatched with the
+	// other queued events.
+	void AddCollisionHandler(id_t typeA, id_t typeB);
+
+	// The solver of spaces created from now on. Spaces created before keep
+	// theirs, but get the new threads and iterations.
+	void SetSpaceParams(const SpaceParams& params);
+
+	const SpaceParams& GetSpaceParams() const
+	{ return m_spaceParams; }
+
+	// Gravity between the bodies of every space, see GravitySolver
+	void SetGravityParams(const GravitySolver::Params& params);
+
+	const GravitySolver::Params& GetGravityParams() const
+	{ return m_gravityParams; }
 
-	void Update(Entity& ent, Transform& transf, Physics& physics);
+	// Mass from which bodies source gravity without Physics::attractor
+	void SetAttractorMass(cpFloat mass)
+	{ m_attractorMass = mass; }
+
+	cpFloat GetAttractorMass() const
+	{ return m_attractorMass; }
+
+	// Steps the spaces, which never interact, as parallel jobs on threadPool,
+	// or one after the other for nullptr. Each job steps its space, applies
+	// gravity and syncs the Transforms of its bodies. Hasty spaces stepped in parallel
+	// split the threads of the pool between them instead of SpaceParams::threads
+	// each, so the solvers don't oversubscribe the cores.
+	void SetThreadPool(ThreadPool* threadPool)
+	{ m_threadPool = threadPool; }
+
+	// Writes the Transforms of the entities with bodies
+	void Simulate(float dt);
 };
 
 } // namespace Starbase
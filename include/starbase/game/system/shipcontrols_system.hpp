@@ -1,7 +1,7 @@
 #pragma once
 
 #include <starbase/game/entity/entitymanager.hpp>
-#include <starbase/game/resource/resourceloader.hpp>
+#include <starbase/game/entity/prefab_registry.hpp>
 #include <starbase/game/component/physics.hpp>
 #include <starbase/game/component/shipcontrols.hpp>
 
@@ -11,9 +11,12 @@ class ShipControlsSystem {
 public:
 
 	EntityManager& m_em;
-	ResourceLoader& m_resourceLoader;
+	PrefabRegistry& m_prefabs;
 
-	ShipControlsSystem(EntityManager& em, ResourceLoader& resourceLoader) : m_em(em), m_resourceLoader(resourceLoader) {}
+	// Looked up on the first shot, then instantiated without any lookup
+	const Prefab* m_bulletPrefab;
+
+	ShipControlsSystem(EntityManager& em, PrefabRegistry& prefabs) : m_em(em), m_prefabs(prefabs), m_bulletPrefab(nullptr) {}
 
 	void SpawnBullet(int step, const id_t spaceId, const glm::vec2& pos, const glm::vec2& vel);
 
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <starbase/game/thread_pool.hpp>
+#include <starbase/game/entity/entity.hpp>
+
+namespace Starbase {
+
+// Runs the systems of a game tick, concurrently where the components they
+// declare to read and write allow it. A system conflicting with an earlier
+// added one always runs after it, so the order of Add() calls stays the
+// order of any two systems that touch the same data.
+class SystemScheduler {
+public:
+	typedef Entity::component_bitset component_bitset;
+	typedef std::function<void()> system_function;
+
+	// Components a system accesses. Exclusive systems, i.e. those applying
+	// structural changes like TEntityManager::Update(), conflict with all other
+	// systems. Creating and removing entities and components is recorded in
+	// command buffers, so it doesn't make a system exclusive.
+	struct Access {
+		component_bitset reads;
+		component_bitset writes;
+		bool exclusive;
+
+		Access()
+			: exclusive(false)
+		{}
+
+		template<typename ...Cs>
+		Access& Reads()
+		{ reads |= Entity::BitsetOf<Cs...>(); return *this; }
+
+		template<typename ...Cs>
+		Access& Writes()
+		{ writes |= Entity::BitsetOf<Cs...>(); return *this; }
+
+		Access& Exclusive()
+		{ exclusive = true; return *this; }
+
+		bool ConflictsWith(const Access& other) const;
+	};
+
+	struct Timing {
+		double lastMs;
+		double averageMs; // exponential moving average
+		Timing() : lastMs(0.0), averageMs(0.0) {}
+	};
+
+private:
+	struct System {
+		std::string name;
+		Access access;
+		system_function fun;
+		Timing timing;
+
+		// Later systems that have to wait for this one
+		std::vector<std::size_t> dependents;
+		std::size_t numDependencies;
+	};
+
+	ThreadPool& m_threadPool;
+	std::vector<System> m_systems;
+
+	// Scratch space of Run()
+	std::vector<std::size_t> m_pending;
+	std::vector<std::size_t> m_ready;
+	std::vector<std::size_t> m_wave;
+
+	void RunSystem(System& system);
+
+public:
+	explicit SystemScheduler(ThreadPool& threadPool);
+
+	void Add(const std::string& name, const Access& access, system_function fun);
+
+	// Runs every system once. Systems whose dependencies are done run together
+	// as a wave, one ParallelFor grain each; a system running alone runs on the
+	// calling thread. Parallel loops of a system in a wave are jobs of their
+	// own on the pool, which the workers done with their systems help with.
+	void Run();
+
+	template<typename F>
+	void ForEachTiming(F fun) const
+	{
+		for (const System& system : m_systems) {
+			fun(system.name, system.timing);
+		}
+	}
+
+	void LogTimings() const;
+};
+
+} // namespace Starbase
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Starbase {
+
+// Fixed set of worker threads for data-parallel loops. The calling thread
+// takes part in every loop, so a pool without workers runs everything inline.
+class ThreadPool {
+public:
+	typedef std::function<void(std::size_t begin, std::size_t end)> range_function;
+
+private:
+	struct Job {
+		const range_function* fun;
+		std::size_t count;
+		std::size_t grainSize;
+		std::atomic<std::size_t> next;
+
+		// Workers running grains of the job, guarded by m_mutex
+		std::size_t busy;
+	};
+
+	std::vector<std::thread> m_workers;
+
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+
+	// Jobs workers may join, one per running ParallelFor; nested loops and
+	// loops from different threads each add their own
+	std::vector<Job*> m_jobs;
+	bool m_quit;
+
+	void WorkerMain();
+
+	// A job with grains left, or nullptr; called with m_mutex held
+	Job* FindJob() const;
+
+	static void RunGrains(Job& job);
+
+public:
+	// Number of workers used when none is given: one less than the hardware
+	// threads, as the calling thread works too
+	static std::size_t DefaultWorkerCount();
+
+	explicit ThreadPool(std::size_t numWorkers = DefaultWorkerCount());
+
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Workers plus the calling thread
+	std::size_t GetThreadCount() const
+	{ return m_workers.size() + 1; }
+
+	// True when called from within a ParallelFor range, on any thread
+	static bool InParallelFor();
+
+	// Calls fun(begin, end) for consecutive ranges of at most grainSize elements
+	// covering [0, count), and returns when all of them are done. Runs inline
+	// when the range fits in one grain. May be called from within a range, e.g.
+	// by a system of a SystemScheduler wave: the nested loop is a job of its
+	// own, which idle workers help with.
+	void ParallelFor(std::size_t count, std::size_t grainSize, const range_function& fun);
+};
+
+} // namespace Starbase
@@ -18,3 +18,8 @@
 #else
     #define SB_UNUSED x
 #endif
+
+// SSE is available on every x86-64 target, and on x86 when enabled
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#define SB_SSE 1
+#endif
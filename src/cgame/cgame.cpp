@@ -26,7 +26,19 @@ CGame::CGame(Display& display, IFilesystem& filesystem, UI::MainWindow& mainWind
 	, m_display(display)
 	, m_renderer(display, filesystem, m_resourceLoader, m_eventManager)
 	, m_mainWindow(mainWindow)
-{}
+{
+	// The GL model is looked up again by EntityRenderer when the entity is restored
+	m_entityManager.SetSerializer<Renderable>(
+		[](const Renderable& rend, SnapshotWriter& writer) {
+			writer.Write(rend.model->Id());
+		},
+		[this](SnapshotReader& reader, Renderable& rend) {
+			id_t modelId = 0;
+			if (reader.Read(modelId))
+				rend.model = SharedModel(m_resourceLoader.Load<Model>(modelId));
+		}
+	);
+}
 
 bool CGame::Init()
 {
@@ -41,18 +53,18 @@ bool CGame::Init()
 		"models/planets/simple",
 		Transform(
 			glm::vec2(0.f, -50.f),
-			0.f,
-			glm::vec2(1.4f, 1.4f)
-		)
+			0.f
+		),
+		Scale(glm::vec2(1.4f, 1.4f))
 	);
 
 	AddTestEntity(
 		"models/doodads/box",
 		Transform(
 			glm::vec2(20.f, 50.f),
-			0.f,
-			glm::vec2(1.4f, 1.4f)
-		)
+			0.f
+		),
+		Scale(glm::vec2(1.4f, 1.4f))
 	);
 
 	m_playerEntityId = AddTestEntity(
@@ -137,8 +149,10 @@ void CGame::CMain()
 
 		m_display.Swap();
 
-		if (m_step % 100 == 0)
+		if (m_step % 100 == 0) {
 			LOG(info) << "FPS: " << 1.0 / frameTime;
+			m_systemScheduler.LogTimings();
+		}
 
 		if (!PollEvents()) {
 			// Got SDL_QUIT
@@ -147,23 +161,24 @@ void CGame::CMain()
 	}
 }
 
-entity_id CGame::AddTestEntity(const char* id, const Transform& transf)
+entity_id CGame::AddTestEntity(const char* id, const Transform& transf, const Scale& scale, const glm::vec2& vel)
 {
-	const ResourcePtr<Model> model = m_resourceLoader.Load<Model>(ID(id));
-	const ResourcePtr<Body> body = m_resourceLoader.Load<Body>(ID(id));
-
-	return m_entityManager.CreateEntity<Transform, Physics, ShipControls, Renderable>(
-		Transform(transf),
-		Physics(TEST_SPACE, body),
-		ShipControls(),
-		Renderable(model)
-	).id;
+	std::tuple<Entity&, Transform&, Scale&, Physics&> ent =
+		m_entityManager.Instantiate<Transform, Scale, Physics>(m_prefabRegistry.Load(ID(id)));
+
+	std::get<1>(ent) = transf;
+	std::get<2>(ent) = scale;
+	std::get<3>(ent).spaceId = TEST_SPACE;
+	std::get<3>(ent).initialVel = vel;
+
+	return std::get<0>(ent).id;
 }
 
 bool CGame::HandleSDLEvent(SDL_Event event)
 {
 	Entity& playerEntity = m_entityManager.GetEntity(m_playerEntityId);
 	Transform& transf = playerEntity.GetComponent<Transform>();
+	Physics& phys = playerEntity.GetComponent<Physics>();
 	ShipControls& scontrols = playerEntity.GetComponent<ShipControls>();
 	RenderParams& renderParams = m_renderer.m_renderParams;
 
@@ -183,10 +198,10 @@ bool CGame::HandleSDLEvent(SDL_Event event)
 				"models/doodads/box",
 				Transform(
 					transf.pos - glm::vec2(0, -15.f),
-					transf.rot,
-					glm::vec2(5.f, 5.f),
-					transf.vel
-				)
+					transf.rot
+				),
+				Scale(glm::vec2(5.f, 5.f)),
+				to_vec2f(cpBodyGetVelocity(phys.cp.body.get()))
 			);
 		}
 		return true;
@@ -232,10 +247,21 @@ void CGame::Render(double alpha)
 	renderParams->offset = m_camera.m_pos;
 
 	m_renderer.BeginDraw();
-	m_entityManager.ForEachEntityWithComponents<Transform, Renderable>([&](Entity& ent, Transform& trans, Renderable& rend) {
+
+	// Matrices are computed in parallel, from the transforms gathered in
+	// lanes; GL calls have to stay on this thread
+	m_prepareBatch.Clear();
+	m_entityManager.GetView<const Transform, const Scale, Renderable>().ForEach([&](Entity&, const Transform& trans, const Scale& scale, Renderable& rend) {
+		m_prepareBatch.Add(trans, scale, rend);
+	});
+	m_threadPool.ParallelFor(m_prepareBatch.Size(), 1024, [&](std::size_t begin, std::size_t end) {
+		m_renderer.Prepare(alpha, m_prepareBatch, begin, end);
+	});
+
+	m_entityManager.GetView<const Transform, const Scale, const Renderable>().ForEach([&](Entity& ent, const Transform& trans, const Scale& scale, const Renderable& rend) {
 		const Physics* phys = ent.GetComponentOrNull<Physics>();
 		const ShipControls* contr = ent.GetComponentOrNull<ShipControls>();
-		m_renderer.Draw(alpha, Renderer::ComponentGroup(ent, trans, rend, phys, contr));
+		m_renderer.Draw(alpha, Renderer::ComponentGroup(ent, trans, scale, rend, phys, contr));
 	});
 	m_renderer.EndDraw();
 }
@@ -2,14 +2,17 @@
 #include <limits>
 #include <cmath>
 #include <cassert>
+#include <cstddef>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #include <starbase/game/logging.hpp>
+#include <starbase/game/interpolation.hpp>
 #include <starbase/game/entity/entity.hpp>
 #include <starbase/game/component/transform.hpp>
+#include <starbase/game/component/scale.hpp>
 #include <starbase/game/component/physics.hpp>
 #include <starbase/game/component/shipcontrols.hpp>
 
@@ -260,6 +263,15 @@ EntityRenderer::EntityRenderer(IFilesystem& fs, const RenderParams& renderParams
 	eventManager.Connect<Renderable, EventManager::component_removed>([this](Entity& ent, Renderable& rend) {
 		RenderableRemoved(rend);
 	});
+	eventManager.Connect<EventManager::entities_added>([this](Entity* entities, std::size_t count) {
+		for (std::size_t i = 0; i < count; i++) {
+			Entity& ent = entities[i];
+			if (ent.HasComponent<Physics>())
+				PhysicsAdded(ent.GetComponent<Physics>());
+			if (ent.HasComponent<Renderable>())
+				RenderableAdded(ent.GetComponent<Renderable>());
+		}
+	});
 }
 
 bool EntityRenderer::Init()
@@ -275,47 +287,51 @@ bool EntityRenderer::Init()
 
 void EntityRenderer::RenderableAdded(const Renderable& rend)
 {
-	const ResourcePtr<Model>& model = rend.model;
+	const std::uint32_t index = rend.model.Index();
+	if (index >= m_modelsGL.size())
+		m_modelsGL.resize(index + 1);
 
-	if (!m_modelsGL.count(model.Id())) {
-		m_modelsGL.emplace(model.Id(), ModelGL(*model));
+	if (!m_modelsGL[index]) {
+		m_modelsGL[index] = std::make_unique<ModelGL>(**rend.model);
 	} else {
-		m_modelsGL.at(model.Id()).refcount++;
+		m_modelsGL[index]->refcount++;
 	}
 }
 
 void EntityRenderer::RenderableRemoved(const Renderable& rend)
 {
-	ModelGL& modelGL = m_modelsGL.at(rend.model.Id());
-	modelGL.refcount--;
+	std::unique_ptr<ModelGL>& modelGL = m_modelsGL.at(rend.model.Index());
+	modelGL->refcount--;
 
-	if (modelGL.refcount < 0) {
-		m_modelsGL.erase(rend.model.Id());
+	if (modelGL->refcount < 0) {
+		modelGL.reset();
 	}
 }
 
 void EntityRenderer::PhysicsAdded(const Physics& phys)
 {
-	const ResourcePtr<Body>& body = phys.body;
+	const std::uint32_t index = phys.body.Index();
+	if (index >= m_bodiesGL.size())
+		m_bodiesGL.resize(index + 1);
 
-	if (!m_bodiesGL.count(body.Id())) {
-		m_bodiesGL.emplace(body.Id(), BodyGL(*body));
+	if (!m_bodiesGL[index]) {
+		m_bodiesGL[index] = std::make_unique<BodyGL>(**phys.body);
 	} else {
-		m_bodiesGL.at(body.Id()).refcount++;
+		m_bodiesGL[index]->refcount++;
 	}
 }
 
 void EntityRenderer::PhysicsRemoved(const Physics& phys)
 {
-	BodyGL& bodyGL = m_bodiesGL.at(phys.body.Id());
-	bodyGL.refcount--;
+	std::unique_ptr<BodyGL>& bodyGL = m_bodiesGL.at(phys.body.Index());
+	bodyGL->refcount--;
 
-	if (bodyGL.refcount < 0) {
-		m_bodiesGL.erase(phys.body.Id());
+	if (bodyGL->refcount < 0) {
+		bodyGL.reset();
 	}
 }
 
-static glm::mat4 CalcMatrix(double alpha, const Transform& trans, const RenderParams& renderParams)
+static glm::mat4 CalcMatrix(double alpha, const Transform& trans, const Scale& scale, const RenderParams& renderParams)
 {
 	glm::mat4 model, view, projection;
 
@@ -339,19 +355,76 @@ static glm::mat4 CalcMatrix(double alpha, const Transform& trans, const RenderPa
 	model = glm::translate(model, glm::vec3(renderPos, 0));
 	model = glm::translate(model, glm::vec3(-renderParams.offset, 0));
 	model = glm::rotate(model, trans.rot, glm::vec3(0.f, 0.f, 1.f));
-	model = glm::scale(model, glm::vec3(trans.scale.x, trans.scale.y, 1.f));
+	model = glm::scale(model, glm::vec3(scale.value.x, scale.value.y, 1.f));
 
 	view = glm::mat4(1.f);
 
 	return projection * view * model;
 }
 
+void EntityRenderer::PrepareBatch::Clear()
+{
+	inputs.Clear();
+	renderables.clear();
+}
+
+void EntityRenderer::PrepareBatch::Add(const Transform& trans, const Scale& scale, Renderable& rend)
+{
+	inputs.PushBack(PrepareInput{
+		trans.pos.x, trans.pos.y,
+		trans.prevPos.x, trans.prevPos.y,
+		trans.rot,
+		scale.value.x, scale.value.y
+	});
+	renderables.push_back(&rend);
+}
+
+// Same matrix as CalcMatrix(), for the entities [begin, end) of a batch
+void EntityRenderer::Prepare(double alpha, PrepareBatch& batch, std::size_t begin, std::size_t end) const
+{
+	using Lanes = TSoAVector<PrepareInput>;
+	Lanes& inputs = batch.inputs;
+
+	const float* posX = inputs.Lane(Lanes::LaneOf(offsetof(PrepareInput, posX))) + begin;
+	const float* posY = inputs.Lane(Lanes::LaneOf(offsetof(PrepareInput, posY))) + begin;
+	const float* rot = inputs.Lane(Lanes::LaneOf(offsetof(PrepareInput, rot))) + begin;
+	const float* scaleX = inputs.Lane(Lanes::LaneOf(offsetof(PrepareInput, scaleX))) + begin;
+	const float* scaleY = inputs.Lane(Lanes::LaneOf(offsetof(PrepareInput, scaleY))) + begin;
+
+	// The interpolated positions replace the previous ones, which aren't needed anymore
+	float* renderX = inputs.Lane(Lanes::LaneOf(offsetof(PrepareInput, prevPosX))) + begin;
+	float* renderY = inputs.Lane(Lanes::LaneOf(offsetof(PrepareInput, prevPosY))) + begin;
+
+	const std::size_t count = end - begin;
+	InterpolateLanes(renderX, posX, static_cast<float>(alpha), renderX, count);
+	InterpolateLanes(renderY, posY, static_cast<float>(alpha), renderY, count);
+
+	// Orthographic projection times translation, rotation and scale, written
+	// out, as the projection is a plain scale for a window centered on 0
+	const float zoom = m_renderParams.zoom;
+	const float projX = zoom / static_cast<float>(m_renderParams.windowSize.x);
+	const float projY = zoom / static_cast<float>(m_renderParams.windowSize.y);
+	const glm::vec2 offset = m_renderParams.offset;
+
+	for (std::size_t i = 0; i < count; i++) {
+		const float c = std::cos(rot[i]);
+		const float s = std::sin(rot[i]);
+
+		batch.renderables[begin + i]->mvp = glm::mat4(
+			projX * c * scaleX[i], projY * s * scaleX[i], 0.f, 0.f,
+			-projX * s * scaleY[i], projY * c * scaleY[i], 0.f, 0.f,
+			0.f, 0.f, -1.f, 0.f,
+			projX * (renderX[i] - offset.x), projY * (renderY[i] - offset.y), 0.f, 1.f
+		);
+	}
+}
+
 void EntityRenderer::Draw(double alpha, const EntityRenderer::ComponentGroup& cg)
 {
 	NormalDraw(alpha, cg);
 
 	if (cg.phys != nullptr && m_renderParams.debug) {
-		DebugDraw(alpha, cg.ent, cg.trans, *cg.phys);
+		DebugDraw(alpha, cg.ent, cg.trans, cg.scale, *cg.phys);
 	}
 }
 
@@ -365,9 +438,8 @@ static bool IsPathVisible(const EntityRenderer::ComponentGroup& cg, const Model:
 
 void EntityRenderer::NormalDraw(double alpha, const EntityRenderer::ComponentGroup& cg)
 {
-	const id_t modelId = cg.rend.model.Id();
-	const ModelGL& modelGL = m_modelsGL.at(modelId);
-	const Model& model = *cg.rend.model.Get();
+	const ModelGL& modelGL = *m_modelsGL[cg.rend.model.Index()];
+	const Model& model = **cg.rend.model;
 
 	const std::size_t numPaths = model.GetPaths().size();
 	assert(modelGL.paths.size() == numPaths);
@@ -391,11 +463,9 @@ void EntityRenderer::NormalDraw(double alpha, const EntityRenderer::ComponentGro
 		if (!IsPathVisible(cg, path))
 			continue;
 
-		glm::mat4 mvp = CalcMatrix(alpha, cg.trans, m_renderParams);
-
-		GLCALL(glUniformMatrix4fv(m_pathShader.uniforms.mvp, 1, GL_FALSE, glm::value_ptr(mvp)));
+		GLCALL(glUniformMatrix4fv(m_pathShader.uniforms.mvp, 1, GL_FALSE, glm::value_ptr(cg.rend.mvp)));
 
-		GLCALL(glUniform2f(m_pathShader.uniforms.scale, cg.trans.scale.x, cg.trans.scale.y));
+		GLCALL(glUniform2f(m_pathShader.uniforms.scale, cg.scale.value.x, cg.scale.value.y));
 		GLCALL(glUniform1f(m_pathShader.uniforms.thickness, style.thickness));
 		GLCALL(glUniform1f(m_pathShader.uniforms.zoom, m_renderParams.zoom));
 
@@ -437,13 +507,12 @@ void EntityRenderer::NormalDraw(double alpha, const EntityRenderer::ComponentGro
 	}
 }
 
-void EntityRenderer::DebugDraw(double alpha, const Entity& ent, const Transform& trans, const Physics& physics)
+void EntityRenderer::DebugDraw(double alpha, const Entity& ent, const Transform& trans, const Scale& scale, const Physics& physics)
 {
-	const id_t bodyId = physics.body.Id();
-	const BodyGL& bodyGL = m_bodiesGL.at(bodyId);
-	const Body& body = *physics.body.Get();
+	const BodyGL& bodyGL = *m_bodiesGL[physics.body.Index()];
+	const Body& body = **physics.body;
 
-	glm::mat4 mvp = CalcMatrix(alpha, trans, m_renderParams);
+	glm::mat4 mvp = CalcMatrix(alpha, trans, scale, m_renderParams);
 
 	const std::size_t numShapes = body.GetPolygonShapes().size();
 	for (std::size_t i = 0; i < numShapes; i++) {
@@ -255,6 +255,11 @@ void Renderer::EndDraw()
 	glDisableVertexAttribArray(m_fbA.attributes.texCoord);*/
 }
 
+void Renderer::Prepare(double alpha, PrepareBatch& batch, std::size_t begin, std::size_t end) const
+{
+	m_entityRenderer.Prepare(alpha, batch, begin, end);
+}
+
 void Renderer::Draw(double alpha, const Renderer::ComponentGroup& cg)
 {
 	m_entityRenderer.Draw(alpha, cg);
@@ -0,0 +1,536 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <starbase/game/entity/template/entitymanager.hpp>
+#include <starbase/game/entity/template/eventmanager.hpp>
+#include <starbase/game/entity/template/event_list.hpp>
+#include <starbase/game/thread_pool.hpp>
+
+// Micro-benchmarks of TEntityManager, run against every storage backend.
+// Exits with 1 when a parallel loop nested in a wave of systems would run on
+// a single thread, or when unchanged entities are visited as changed. Prints
+// the results as JSON on stdout:
+//
+//   starbase_ecs_bench [max entities] > results.json
+
+using namespace Starbase;
+
+namespace {
+
+struct Position {
+	float x, y;
+	Position() : x(0.f), y(0.f) {}
+	Position(float x, float y) : x(x), y(y) {}
+};
+
+struct Velocity {
+	float x, y;
+	Velocity() : x(0.f), y(0.f) {}
+	Velocity(float x, float y) : x(x), y(y) {}
+};
+
+struct Health {
+	int hp;
+	Health() : hp(100) {}
+};
+
+// Bigger component, to make the per-entity footprint realistic
+struct Payload {
+	float data[16];
+	Payload() : data() {}
+};
+
+// Layouts of the game's Transform before and after splitting off the cold
+// fields, with floats in place of glm vectors
+struct TransformBefore {
+	float pos[2], prevPos[2];
+	float rot;
+	float scale[2], vel[2];
+	TransformBefore() : pos(), prevPos(), rot(0.f), scale{ 1.f, 1.f }, vel() {}
+};
+
+struct TransformAfter {
+	float pos[2], prevPos[2];
+	float rot;
+	TransformAfter() : pos(), prevPos(), rot(0.f) {}
+};
+
+struct ScaleAfter {
+	float value[2];
+	ScaleAfter() : value{ 1.f, 1.f } {}
+};
+
+// What PhysicsSystem::SyncTransform reads from the chipmunk body
+struct BodyState {
+	float pos[2], vel[2];
+	float angle;
+	BodyState() : pos(), vel(), angle(0.f) {}
+};
+
+// Per-frame data EntityRenderer::Prepare writes, the mvp matrix
+struct RenderData {
+	float mvp[16];
+	RenderData() : mvp() {}
+};
+
+// Entity record before the manager pointer was replaced by a slot
+struct EntityBefore {
+	entity_id id;
+	TComponentMask<MAX_COMPONENTS> bitset;
+	bool alive : 1;
+	bool isnew : 1;
+	void* entityManager;
+};
+
+struct Result {
+	std::string backend;
+	std::string name;
+	std::size_t entities;
+	double nsPerEntity;
+};
+
+// Memory a per-step system touches, by entity layout
+struct LayoutResult {
+	std::string backend;
+	std::string system;
+	std::string layout;
+	std::size_t entities;
+	std::size_t bytesPerEntity;
+	double nsPerEntity;
+};
+
+using clock_type = std::chrono::steady_clock;
+
+// Keeps the optimizer from dropping the benchmarked loops
+volatile float g_sink;
+
+double ElapsedNs(clock_type::time_point start)
+{
+	return std::chrono::duration<double, std::nano>(clock_type::now() - start).count();
+}
+
+// Runs fun a few times, and returns the fastest run in ns per entity
+template<typename F>
+double Measure(std::size_t entities, std::size_t repetitions, F fun)
+{
+	double best = std::numeric_limits<double>::max();
+	for (std::size_t i = 0; i < repetitions; i++) {
+		const clock_type::time_point start = clock_type::now();
+		fun();
+		best = std::min(best, ElapsedNs(start));
+	}
+	return best / static_cast<double>(std::max<std::size_t>(entities, 1));
+}
+
+template<template<typename...> class L>
+class Bench {
+private:
+	using CL = L<Position, Velocity, Health, Payload>;
+	using EventManager = TEventManager<CL, TEventList<>>;
+	using EntityManager = TEntityManager<CL>;
+	using Entity = TEntity<CL>;
+
+	const char* m_backend;
+	std::vector<Result>& m_results;
+	std::vector<LayoutResult>& m_layoutResults;
+
+	void Add(const char* name, std::size_t entities, double nsPerEntity)
+	{
+		m_results.push_back(Result{ m_backend, name, entities, nsPerEntity });
+	}
+
+	// Every other entity moves, every fourth one has health
+	static std::vector<entity_id> Populate(EntityManager& em, std::size_t count)
+	{
+		std::vector<entity_id> ids;
+		ids.reserve(count);
+
+		for (std::size_t i = 0; i < count; i++) {
+			const float f = static_cast<float>(i);
+
+			if (i % 4 == 0)
+				ids.push_back(em.CreateEntity(Position(f, f), Velocity(1.f, 1.f), Health(), Payload()).id);
+			else if (i % 2 == 0)
+				ids.push_back(em.CreateEntity(Position(f, f), Velocity(1.f, 1.f), Payload()).id);
+			else
+				ids.push_back(em.CreateEntity(Position(f, f), Payload()).id);
+		}
+
+		em.Update();
+		return ids;
+	}
+
+	void CreateDestroy(std::size_t count)
+	{
+		EventManager events;
+		EntityManager em(events);
+		std::vector<entity_id> ids;
+		ids.reserve(count);
+
+		// Measured once, as the manager only grows the first time
+		clock_type::time_point start = clock_type::now();
+		for (std::size_t i = 0; i < count; i++) {
+			ids.push_back(em.CreateEntity(Position(), Velocity(), Payload()).id);
+		}
+		Add("create", count, ElapsedNs(start) / count);
+
+		start = clock_type::now();
+		em.Update();
+		Add("update_promote", count, ElapsedNs(start) / count);
+
+		start = clock_type::now();
+		for (entity_id id : ids) {
+			em.RemoveEntity(em.GetEntity(id));
+		}
+		em.Update();
+		Add("destroy", count, ElapsedNs(start) / count);
+
+		// Second round, on recycled slots
+		start = clock_type::now();
+		for (std::size_t i = 0; i < count; i++) {
+			em.CreateEntity(Position(), Velocity(), Payload());
+		}
+		em.Update();
+		Add("create_recycled", count, ElapsedNs(start) / count);
+	}
+
+	void CreateBatch(std::size_t count)
+	{
+		EventManager events;
+		EntityManager em(events);
+
+		const clock_type::time_point start = clock_type::now();
+		em.template CreateEntities<Position, Velocity, Payload>(count, [](std::size_t i, Position& pos, Velocity& vel, Payload&) {
+			pos.x = static_cast<float>(i);
+			vel.x = 1.f;
+		});
+		em.Update();
+		Add("create_batch", count, ElapsedNs(start) / count);
+	}
+
+	// Same entities as CreateDestroy() creates, from a prefab
+	void InstantiatePrefab(std::size_t count)
+	{
+		EventManager events;
+		EntityManager em(events);
+
+		TPrefab<CL> prefab;
+		prefab.Set(Position(1.f, 2.f));
+		prefab.Set(Velocity(1.f, 1.f));
+		prefab.Set(Payload());
+
+		clock_type::time_point start = clock_type::now();
+		for (std::size_t i = 0; i < count; i++) {
+			em.Instantiate(prefab);
+		}
+		Add("instantiate", count, ElapsedNs(start) / count);
+
+		start = clock_type::now();
+		em.Update();
+		Add("instantiate_promote", count, ElapsedNs(start) / count);
+	}
+
+	void Iterate(std::size_t count, std::size_t repetitions)
+	{
+		EventManager events;
+		EntityManager em(events);
+		std::vector<entity_id> ids = Populate(em, count);
+
+		Add("foreach_2", count, Measure(count, repetitions, [&] {
+			em.template ForEachEntityWithComponents<Position, Velocity>([](Entity&, Position& pos, Velocity& vel) {
+				pos.x += vel.x;
+				pos.y += vel.y;
+			});
+		}));
+
+		Add("foreach_3", count, Measure(count, repetitions, [&] {
+			float sum = 0.f;
+			em.template ForEachEntityWithComponents<Position, Velocity, Health>([&](Entity&, Position& pos, Velocity&, Health& health) {
+				sum += pos.x * static_cast<float>(health.hp);
+			});
+			g_sink = sum;
+		}));
+
+		auto view = em.template GetView<Position, const Velocity>();
+		Add("view_2", count, Measure(count, repetitions, [&] {
+			view.ForEach([](Entity&, Position& pos, const Velocity& vel) {
+				pos.x += vel.x;
+				pos.y += vel.y;
+			});
+		}));
+
+		std::shuffle(ids.begin(), ids.end(), std::mt19937(1234));
+		Add("get_component_random", count, Measure(count, repetitions, [&] {
+			float sum = 0.f;
+			for (entity_id id : ids) {
+				sum += em.GetEntity(id).template GetComponent<Position>().x;
+			}
+			g_sink = sum;
+		}));
+	}
+
+	// A parallel loop run by one of the systems of a SystemScheduler wave,
+	// which runs its systems as a ParallelFor, see CheckNestedParallelFor()
+	void NestedParallel(std::size_t count, std::size_t repetitions)
+	{
+		ThreadPool pool;
+		EventManager events;
+		EntityManager em(events);
+		em.SetThreadPool(&pool);
+		Populate(em, count);
+
+		auto view = em.template GetView<Position, const Velocity>();
+		const ThreadPool::range_function wave = [&](std::size_t begin, std::size_t end) {
+			for (std::size_t system = begin; system < end; system++) {
+				if (system != 0)
+					continue;
+
+				view.ParallelForEach([](Entity&, Position& pos, const Velocity& vel) {
+					pos.x += vel.x;
+					pos.y += vel.y;
+				}, 1024);
+			}
+		};
+
+		Add("parallel_foreach_in_wave", count, Measure(count, repetitions, [&] {
+			pool.ParallelFor(2, 1, wave);
+		}));
+	}
+
+public:
+	// The per-step systems of the game, on the Transform layout before and
+	// after the hot/cold split. Bytes per entity count the entity record, which
+	// loops walk, and the components read and written.
+	void Layout(std::size_t count, std::size_t repetitions)
+	{
+		using BeforeCL = L<TransformBefore, BodyState, RenderData>;
+		using AfterCL = L<TransformAfter, ScaleAfter, BodyState, RenderData>;
+
+		{
+			TEventManager<BeforeCL, TEventList<>> events;
+			TEntityManager<BeforeCL> em(events);
+			em.template CreateEntities<TransformBefore, BodyState, RenderData>(count, [](std::size_t, TransformBefore&, BodyState&, RenderData&) {});
+			em.Update();
+
+			const double physicsNs = Measure(count, repetitions, [&] {
+				em.template ForEachEntityWithComponents<TransformBefore, BodyState>([](TEntity<BeforeCL>&, TransformBefore& transf, BodyState& body) {
+					transf.prevPos[0] = transf.pos[0];
+					transf.prevPos[1] = transf.pos[1];
+					transf.pos[0] = body.pos[0];
+					transf.pos[1] = body.pos[1];
+					transf.rot = body.angle;
+					transf.vel[0] = body.vel[0];
+					transf.vel[1] = body.vel[1];
+				});
+			});
+			AddLayout("physics_update", "before", count, sizeof(EntityBefore) + sizeof(TransformBefore) + sizeof(BodyState), physicsNs);
+
+			const double prepareNs = Measure(count, repetitions, [&] {
+				em.template ForEachEntityWithComponents<TransformBefore, RenderData>([](TEntity<BeforeCL>&, TransformBefore& transf, RenderData& rend) {
+					rend.mvp[0] = transf.scale[0];
+					rend.mvp[5] = transf.scale[1];
+					rend.mvp[12] = transf.prevPos[0] + (transf.pos[0] - transf.prevPos[0]) * 0.5f;
+					rend.mvp[13] = transf.prevPos[1] + (transf.pos[1] - transf.prevPos[1]) * 0.5f;
+					rend.mvp[1] = transf.rot;
+				});
+			});
+			AddLayout("render_prepare", "before", count, sizeof(EntityBefore) + sizeof(TransformBefore) + sizeof(RenderData), prepareNs);
+		}
+
+		{
+			TEventManager<AfterCL, TEventList<>> events;
+			TEntityManager<AfterCL> em(events);
+			em.template CreateEntities<TransformAfter, ScaleAfter, BodyState, RenderData>(count, [](std::size_t, TransformAfter&, ScaleAfter&, BodyState&, RenderData&) {});
+			em.Update();
+
+			const double physicsNs = Measure(count, repetitions, [&] {
+				em.template ForEachEntityWithComponents<TransformAfter, BodyState>([](TEntity<AfterCL>&, TransformAfter& transf, BodyState& body) {
+					transf.prevPos[0] = transf.pos[0];
+					transf.prevPos[1] = transf.pos[1];
+					transf.pos[0] = body.pos[0];
+					transf.pos[1] = body.pos[1];
+					transf.rot = body.angle;
+				});
+			});
+			AddLayout("physics_update", "after", count, sizeof(TEntity<AfterCL>) + sizeof(TransformAfter) + sizeof(BodyState), physicsNs);
+
+			const double prepareNs = Measure(count, repetitions, [&] {
+				em.template ForEachEntityWithComponents<TransformAfter, ScaleAfter, RenderData>([](TEntity<AfterCL>&, TransformAfter& transf, ScaleAfter& scale, RenderData& rend) {
+					rend.mvp[0] = scale.value[0];
+					rend.mvp[5] = scale.value[1];
+					rend.mvp[12] = transf.prevPos[0] + (transf.pos[0] - transf.prevPos[0]) * 0.5f;
+					rend.mvp[13] = transf.prevPos[1] + (transf.pos[1] - transf.prevPos[1]) * 0.5f;
+					rend.mvp[1] = transf.rot;
+				});
+			});
+			AddLayout("render_prepare", "after", count, sizeof(TEntity<AfterCL>) + sizeof(TransformAfter) + sizeof(ScaleAfter) + sizeof(RenderData), prepareNs);
+		}
+	}
+
+	void AddLayout(const char* system, const char* layout, std::size_t entities, std::size_t bytesPerEntity, double nsPerEntity)
+	{
+		m_layoutResults.push_back(LayoutResult{ m_backend, system, layout, entities, bytesPerEntity, nsPerEntity });
+	}
+
+public:
+	Bench(const char* backend, std::vector<Result>& results, std::vector<LayoutResult>& layoutResults)
+		: m_backend(backend)
+		, m_results(results)
+		, m_layoutResults(layoutResults)
+	{}
+
+	void Run(std::size_t maxEntities)
+	{
+		for (std::size_t count = 1000; count <= maxEntities; count *= 10) {
+			// Fewer repetitions for the big worlds, to keep the run short
+			const std::size_t repetitions = std::max<std::size_t>(3, 1000000 / count);
+
+			CreateDestroy(count);
+			CreateBatch(count);
+			InstantiatePrefab(count);
+			Iterate(count, repetitions);
+			NestedParallel(count, repetitions);
+			Layout(count, repetitions);
+		}
+	}
+};
+
+// A parallel loop nested in a range of another one, as in a system of a
+// SystemScheduler wave, has to get the idle workers rather than run on the
+// thread of its range. A loop run inline gets its whole range in one call,
+// which fails the check right away. Otherwise every grain of the nested loop
+// waits, without a timeout, for a second thread to join it. The pool starts
+// its three workers whatever the number of cores, and at least two of them
+// are idle, so one always does.
+bool CheckNestedParallelFor()
+{
+	ThreadPool pool(3);
+	std::mutex mutex;
+	std::condition_variable joined;
+	std::vector<std::thread::id> threads;
+	bool ranInline = false;
+
+	const ThreadPool::range_function nested = [&](std::size_t begin, std::size_t end) {
+		std::unique_lock<std::mutex> lock(mutex);
+		if (end - begin > 1) {
+			ranInline = true;
+			return;
+		}
+
+		if (std::find(threads.begin(), threads.end(), std::this_thread::get_id()) == threads.end())
+			threads.push_back(std::this_thread::get_id());
+
+		joined.notify_all();
+		joined.wait(lock, [&] { return threads.size() >= 2; });
+	};
+
+	pool.ParallelFor(2, 1, [&](std::size_t begin, std::size_t end) {
+		for (std::size_t system = begin; system < end; system++) {
+			if (system == 0)
+				pool.ParallelFor(8, 1, nested);
+		}
+	});
+
+	return !ranInline && threads.size() >= 2;
+}
+
+// Only components marked changed are visited by ForEachChangedSince(), not
+// the ones a loop, view or GetComponent() merely accessed mutably. All
+// entities are accessed every way, and only the even ones marked.
+template<template<typename...> class L>
+bool CheckChangedSince()
+{
+	using CL = L<Position, Velocity>;
+	using Entity = TEntity<CL>;
+
+	TEventManager<CL, TEventList<>> events;
+	TEntityManager<CL> em(events);
+	std::vector<entity_id> ids;
+	for (int i = 0; i < 100; i++) {
+		ids.push_back(em.CreateEntity(Position(static_cast<float>(i), 0.f), Velocity()).id);
+	}
+	em.Update();
+
+	const std::uint32_t tick = em.GetTick();
+	em.template ForEachEntityWithComponents<Position, Velocity>([](Entity&, Position&, Velocity&) {});
+	em.template GetView<Position, Velocity>().ForEach([](Entity& ent, Position& pos, Velocity&) {
+		if (static_cast<int>(pos.x) % 2 == 0)
+			ent.template MarkChanged<Position>();
+	});
+	for (entity_id id : ids) {
+		em.GetEntity(id).template GetComponent<Position>();
+	}
+
+	std::size_t visited = 0;
+	bool odd = false;
+	em.template GetView<const Position>().template ForEachChangedSince<const Position>(tick, [&](Entity&, const Position& pos) {
+		odd = odd || static_cast<int>(pos.x) % 2 != 0;
+		visited++;
+	});
+
+	return visited == ids.size() / 2 && !odd;
+}
+
+void PrintJson(const std::vector<Result>& results, const std::vector<LayoutResult>& layoutResults)
+{
+	std::printf("{\n\t\"benchmarks\": [\n");
+	for (std::size_t i = 0; i < results.size(); i++) {
+		const Result& result = results[i];
+		std::printf("\t\t{ \"backend\": \"%s\", \"name\": \"%s\", \"entities\": %zu, \"ns_per_entity\": %.3f }%s\n",
+			result.backend.c_str(),
+			result.name.c_str(),
+			result.entities,
+			result.nsPerEntity,
+			i + 1 < results.size() ? "," : "");
+	}
+	std::printf("\t],\n\t\"layouts\": [\n");
+	for (std::size_t i = 0; i < layoutResults.size(); i++) {
+		const LayoutResult& result = layoutResults[i];
+		std::printf("\t\t{ \"backend\": \"%s\", \"system\": \"%s\", \"layout\": \"%s\", \"entities\": %zu, \"bytes_per_entity\": %zu, \"bytes_per_frame\": %zu, \"ns_per_entity\": %.3f }%s\n",
+			result.backend.c_str(),
+			result.system.c_str(),
+			result.layout.c_str(),
+			result.entities,
+			result.bytesPerEntity,
+			result.bytesPerEntity * result.entities,
+			result.nsPerEntity,
+			i + 1 < layoutResults.size() ? "," : "");
+	}
+	std::printf("\t]\n}\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+	const std::size_t maxEntities = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+	std::vector<Result> results;
+	std::vector<LayoutResult> layoutResults;
+
+	if (!CheckNestedParallelFor()) {
+		std::fprintf(stderr, "A parallel loop nested in another one ran on a single thread\n");
+		return 1;
+	}
+
+	if (!CheckChangedSince<TComponentList>() || !CheckChangedSince<TArchetypeComponentList>()) {
+		std::fprintf(stderr, "Entities not marked changed were visited as changed\n");
+		return 1;
+	}
+
+	Bench<TComponentList>("pool", results, layoutResults).Run(maxEntities);
+	Bench<TArchetypeComponentList>("archetype", results, layoutResults).Run(maxEntities);
+
+	PrintJson(results, layoutResults);
+	return 0;
+}
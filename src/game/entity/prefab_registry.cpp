@@ -0,0 +1,106 @@
+#include <string>
+
+#include <glm/glm.hpp>
+
+#include <starbase/game/logging.hpp>
+#include <starbase/game/resource/body.hpp>
+#include <starbase/game/resource/detail/model_common.hpp>
+#include <starbase/game/entity/prefab_registry.hpp>
+
+namespace Starbase {
+
+static Transform ParseTransform(const YAML::Node& cfg)
+{
+	Transform transf;
+
+	if (cfg["rotation"]) {
+		transf.rot = glm::radians(cfg["rotation"].as<float>());
+	}
+
+	return transf;
+}
+
+static Scale ParseScale(const YAML::Node& cfg)
+{
+	if (!cfg["scale"])
+		return Scale();
+
+	const YAML::Node& scale = cfg["scale"];
+	if (scale.IsSequence())
+		return Scale(glm::vec2(scale[0].as<float>(), scale[1].as<float>()));
+	else
+		return Scale(glm::vec2(scale.as<float>(), scale.as<float>()));
+}
+
+std::unique_ptr<const Prefab> PrefabRegistry::Create(id_t id)
+{
+	auto prefab = std::make_unique<Prefab>();
+
+	std::string path;
+	YAML::Node cfg;
+	if (!m_resourceLoader.GetFilesystem().GetPathForId(id, path) || !GetModelConfig(m_resourceLoader.GetFilesystem(), path, cfg)) {
+		LOG(error) << "Could not read the prefab of " << id << ", using the default one";
+	}
+
+	const ResourcePtr<Body> body = m_resourceLoader.Load<Body>(id);
+#ifdef STARBASE_CLIENT
+	const ResourcePtr<Model> model = m_resourceLoader.Load<Model>(id);
+#endif
+
+	if (!cfg["prefab"]) {
+		prefab->Set(Transform());
+		prefab->Set(Scale());
+		prefab->Set(Physics(0, body));
+#ifdef STARBASE_CLIENT
+		prefab->Set(Renderable(model));
+#endif
+		return prefab;
+	}
+
+	try {
+		const YAML::Node& prefabCfg = cfg["prefab"];
+
+		if (prefabCfg["transform"]) {
+			const YAML::Node& transformCfg = prefabCfg["transform"];
+			prefab->Set(ParseTransform(transformCfg));
+			prefab->Set(ParseScale(transformCfg));
+		}
+		if (prefabCfg["physics"]) {
+			const YAML::Node& physicsCfg = prefabCfg["physics"];
+			const id_t spaceId = physicsCfg["space"] ? ID(physicsCfg["space"].as<std::string>().c_str()) : 0;
+			const id_t collisionType = physicsCfg["collision"] ? ID(physicsCfg["collision"].as<std::string>().c_str()) : 0;
+			const bool attractor = physicsCfg["attractor"] && physicsCfg["attractor"].as<bool>();
+			prefab->Set(Physics(spaceId, body, collisionType, attractor));
+		}
+		if (prefabCfg["shipcontrols"]) {
+			prefab->Set(ShipControls());
+		}
+		if (prefabCfg["autodestruct"]) {
+			const YAML::Node& autoDestructCfg = prefabCfg["autodestruct"];
+			prefab->Set(AutoDestruct(0, autoDestructCfg["ttl"] ? autoDestructCfg["ttl"].as<int>() : 0));
+		}
+#ifdef STARBASE_CLIENT
+		if (prefabCfg["renderable"]) {
+			prefab->Set(Renderable(model));
+		}
+#endif
+	}
+	catch (...) {
+		LOG(error) << "Parsing the prefab of " << path << " failed";
+	}
+
+	return prefab;
+}
+
+const Prefab& PrefabRegistry::Load(id_t id)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::unique_ptr<const Prefab>& prefab = m_prefabs[id];
+	if (!prefab)
+		prefab = Create(id);
+
+	return *prefab;
+}
+
+} // namespace Starbase
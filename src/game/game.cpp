@@ -9,35 +9,95 @@ namespace Starbase {
 
 Game::Game(IFilesystem& filesystem)
 	: m_entityManager(m_eventManager)
-	, m_physicsSystem(m_eventManager)
+	, m_physicsSystem(m_eventManager, m_entityManager)
 	, m_filesystem(filesystem)
 	, m_resourceLoader(filesystem)
-	, m_shipControlsSystem(m_entityManager, m_resourceLoader)
+	, m_prefabRegistry(m_resourceLoader)
+	, m_shipControlsSystem(m_entityManager, m_prefabRegistry)
 	, m_autoDestructSystem(m_entityManager)
+	, m_systemScheduler(m_threadPool)
 	, m_step(0)
-{}
-
-bool Game::Init()
 {
-	return true;
+	m_entityManager.SetThreadPool(&m_threadPool);
+
+	// The test space holds all ships and bullets, so its solver is threaded
+	PhysicsSystem::SpaceParams spaceParams;
+	spaceParams.hasty = true;
+	m_physicsSystem.SetSpaceParams(spaceParams);
+	m_physicsSystem.SetThreadPool(&m_threadPool);
+	m_physicsSystem.AddCollisionHandler(COLLISION_BULLET, COLLISION_SHIP);
+
+	AddSystems();
+	AddSerializers();
 }
 
-void Game::Update()
+void Game::AddSystems()
 {
 	using namespace std::placeholders;
+	using Access = SystemScheduler::Access;
+
+	// Plays back the entities and components created and removed by the other systems
+	m_systemScheduler.Add("entities", Access().Exclusive(), [this] {
+		m_entityManager.Update();
+
+		if (m_step > 0 && m_step % COMPACT_INTERVAL == 0)
+			m_entityManager.Compact();
+
+		// Query statistics cover the steps since the last dump
+		if (m_step > 0 && m_step % STATS_INTERVAL == 0) {
+			m_entityManager.LogStats();
+			m_entityManager.ResetQueryStats();
+		}
+	});
+
+	// Delivers the events queued during the previous step
+	m_systemScheduler.Add("events", Access().Exclusive(), [this] {
+		m_eventManager.Dispatch();
+	});
 
-	m_entityManager.Update();
+	m_systemScheduler.Add("physics.simulate", Access().Writes<Physics, Transform>(), [this] {
+		m_physicsSystem.Simulate(1.f / 60.f);
+	});
 
-	m_physicsSystem.Simulate(1.f / 60.f);
+	m_systemScheduler.Add("shipcontrols", Access().Reads<Transform>().Writes<Physics, ShipControls>(), [this] {
+		m_entityManager.GetView<const Transform, Physics, ShipControls>().ForEach(
+			std::bind(&ShipControlsSystem::Update, &m_shipControlsSystem, m_step, _1, _2, _3, _4));
+	});
 
-    m_entityManager.ForEachEntityWithComponents<Transform, Physics>(
-        std::bind(&PhysicsSystem::Update, &m_physicsSystem, _1, _2, _3));
+	m_systemScheduler.Add("autodestruct", Access().Reads<AutoDestruct>(), [this] {
+		m_entityManager.GetView<const AutoDestruct>().ForEach(
+			std::bind(&AutoDestructSystem::Update, &m_autoDestructSystem, m_step, _1, _2));
+	});
+}
 
-	m_entityManager.ForEachEntityWithComponents<Transform, Physics, ShipControls>(
-        std::bind(&ShipControlsSystem::Update, &m_shipControlsSystem, m_step, _1, _2, _3, _4));
+void Game::AddSerializers()
+{
+	// The chipmunk body is rebuilt by PhysicsSystem from the restored
+	// Transform, and gets the velocity it had as its initial one
+	m_entityManager.SetSerializer<Physics>(
+		[](const Physics& phys, SnapshotWriter& writer) {
+			writer.Write(phys.spaceId);
+			writer.Write(phys.body->Id());
+			writer.Write(phys.collisionType);
+			writer.Write(phys.attractor);
+			writer.Write(phys.cp.body ? to_vec2f(cpBodyGetVelocity(phys.cp.body.get())) : phys.initialVel);
+		},
+		[this](SnapshotReader& reader, Physics& phys) {
+			id_t bodyId = 0;
+			if (reader.Read(phys.spaceId) && reader.Read(bodyId) && reader.Read(phys.collisionType) && reader.Read(phys.attractor) && reader.Read(phys.initialVel))
+				phys.body = SharedBody(m_resourceLoader.Load<Body>(bodyId));
+		}
+	);
+}
+
+bool Game::Init()
+{
+	return true;
+}
 
-	m_entityManager.ForEachEntityWithComponents<AutoDestruct>(
-		std::bind(&AutoDestructSystem::Update, &m_autoDestructSystem, m_step, _1, _2));
+void Game::Update()
+{
+	m_systemScheduler.Run();
 
 	m_step++;
 }
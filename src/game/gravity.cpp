@@ -0,0 +1,276 @@
+#include <cmath>
+#include <algorithm>
+
+#include <starbase/starbase.hpp>
+#include <starbase/game/gravity.hpp>
+
+#ifdef SB_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace Starbase {
+
+constexpr int GravitySolver::MAX_DEPTH;
+
+// Adds the pull of a mass at offset (dx, dy), without G and the own mass
+static inline void AddPull(double dx, double dy, double mass, double& pullX, double& pullY)
+{
+	const double distSq = dx * dx + dy * dy;
+	if (distSq == 0.0)
+		return;
+
+	const double invDist = 1.0 / std::sqrt(distSq);
+	const double scale = mass * invDist * invDist * invDist;
+	pullX += scale * dx;
+	pullY += scale * dy;
+}
+
+static inline std::uint32_t QuadrantOf(double centerX, double centerY, double x, double y)
+{
+	return (x >= centerX ? 1u : 0u) + (y >= centerY ? 2u : 0u);
+}
+
+void GravitySolver::Build(const double* x, const double* y, std::size_t count)
+{
+	m_nodes.clear();
+	m_next.assign(count, -1);
+
+	double minX = x[0], maxX = x[0];
+	double minY = y[0], maxY = y[0];
+	for (std::size_t i = 1; i < count; i++) {
+		minX = std::min(minX, x[i]);
+		maxX = std::max(maxX, x[i]);
+		minY = std::min(minY, y[i]);
+		maxY = std::max(maxY, y[i]);
+	}
+
+	// Slightly bigger than the bounds, so bodies on the edge are inside
+	const double size = std::max(maxX - minX, maxY - minY);
+	const double halfSize = size > 0.0 ? size * 0.5 * (1.0 + 1e-9) : 1.0;
+
+	Node root;
+	root.centerX = (minX + maxX) * 0.5;
+	root.centerY = (minY + maxY) * 0.5;
+	root.halfSize = halfSize;
+	root.mass = root.massX = root.massY = 0.0;
+	root.children = 0;
+	root.body = -1;
+	root.depth = 0;
+	m_nodes.push_back(root);
+
+	for (std::size_t i = 0; i < count; i++) {
+		Insert(static_cast<std::int32_t>(i), x, y);
+	}
+}
+
+void GravitySolver::Insert(std::int32_t body, const double* x, const double* y)
+{
+	// Nodes are referred to by index, as splitting grows m_nodes
+	std::uint32_t node = 0;
+
+	while (true) {
+		if (m_nodes[node].children) {
+			node = m_nodes[node].children + QuadrantOf(m_nodes[node].centerX, m_nodes[node].centerY, x[body], y[body]);
+			continue;
+		}
+
+		if (m_nodes[node].body < 0 || m_nodes[node].depth >= MAX_DEPTH) {
+			m_next[body] = m_nodes[node].body;
+			m_nodes[node].body = body;
+			return;
+		}
+
+		Split(node, x, y);
+	}
+}
+
+void GravitySolver::Split(std::uint32_t node, const double* x, const double* y)
+{
+	const std::uint32_t children = static_cast<std::uint32_t>(m_nodes.size());
+	const Node parent = m_nodes[node];
+	const double quarter = parent.halfSize * 0.5;
+
+	for (std::uint32_t quadrant = 0; quadrant < 4; quadrant++) {
+		Node child;
+		child.centerX = parent.centerX + ((quadrant & 1) ? quarter : -quarter);
+		child.centerY = parent.centerY + ((quadrant & 2) ? quarter : -quarter);
+		child.halfSize = quarter;
+		child.mass = child.massX = child.massY = 0.0;
+		child.children = 0;
+		child.body = -1;
+		child.depth = parent.depth + 1;
+		m_nodes.push_back(child);
+	}
+
+	// Hand the bodies of the leaf down
+	std::int32_t body = parent.body;
+	while (body >= 0) {
+		const std::int32_t next = m_next[body];
+		Node& child = m_nodes[children + QuadrantOf(parent.centerX, parent.centerY, x[body], y[body])];
+		m_next[body] = child.body;
+		child.body = body;
+		body = next;
+	}
+
+	m_nodes[node].children = children;
+	m_nodes[node].body = -1;
+}
+
+void GravitySolver::AccumulateMass(const double* x, const double* y, const double* mass)
+{
+	for (std::size_t i = m_nodes.size(); i-- > 0;) {
+		Node& node = m_nodes[i];
+
+		double total = 0.0, weightedX = 0.0, weightedY = 0.0;
+		if (node.children) {
+			for (std::uint32_t c = node.children; c < node.children + 4; c++) {
+				const Node& child = m_nodes[c];
+				total += child.mass;
+				weightedX += child.mass * child.massX;
+				weightedY += child.mass * child.massY;
+			}
+		} else {
+			for (std::int32_t body = node.body; body >= 0; body = m_next[body]) {
+				total += mass[body];
+				weightedX += mass[body] * x[body];
+				weightedY += mass[body] * y[body];
+			}
+		}
+
+		node.mass = total;
+		node.massX = total > 0.0 ? weightedX / total : node.centerX;
+		node.massY = total > 0.0 ? weightedY / total : node.centerY;
+	}
+}
+
+void GravitySolver::ComputeTree(const double* x, const double* y, const double* mass, std::size_t count, double* forceX, double* forceY)
+{
+	Build(x, y, count);
+	AccumulateMass(x, y, mass);
+
+	const double thetaSq = m_params.theta * m_params.theta;
+
+	for (std::size_t i = 0; i < count; i++) {
+		double pullX = 0.0, pullY = 0.0;
+
+		m_stack.clear();
+		m_stack.push_back(0);
+
+		while (!m_stack.empty()) {
+			const Node& node = m_nodes[m_stack.back()];
+			m_stack.pop_back();
+
+			if (node.mass == 0.0)
+				continue;
+
+			if (!node.children) {
+				for (std::int32_t body = node.body; body >= 0; body = m_next[body]) {
+					if (static_cast<std::size_t>(body) != i)
+						AddPull(x[body] - x[i], y[body] - y[i], mass[body], pullX, pullY);
+				}
+				continue;
+			}
+
+			// A cell containing the body itself is always opened, so it
+			// doesn't pull on its own mass
+			const double dx = node.massX - x[i];
+			const double dy = node.massY - y[i];
+			const double size = node.halfSize * 2.0;
+			const bool inside = std::abs(x[i] - node.centerX) <= node.halfSize && std::abs(y[i] - node.centerY) <= node.halfSize;
+
+			if (!inside && size * size < thetaSq * (dx * dx + dy * dy)) {
+				AddPull(dx, dy, node.mass, pullX, pullY);
+			} else {
+				for (std::uint32_t c = node.children; c < node.children + 4; c++) {
+					m_stack.push_back(c);
+				}
+			}
+		}
+
+		forceX[i] = m_params.gravityConstant * mass[i] * pullX;
+		forceY[i] = m_params.gravityConstant * mass[i] * pullY;
+	}
+}
+
+void GravitySolver::Compute(const double* x, const double* y, const double* mass, std::size_t count, double* forceX, double* forceY)
+{
+	if (count == 0)
+		return;
+
+	if (m_params.exact)
+		ComputeExact(m_params.gravityConstant, x, y, mass, count, forceX, forceY);
+	else
+		ComputeTree(x, y, mass, count, forceX, forceY);
+}
+
+void GravitySolver::ComputeExact(double gravityConstant, const double* x, const double* y, const double* mass, std::size_t count, double* forceX, double* forceY)
+{
+	for (std::size_t i = 0; i < count; i++) {
+		double pullX = 0.0, pullY = 0.0;
+
+		for (std::size_t j = 0; j < count; j++) {
+			if (j != i)
+				AddPull(x[j] - x[i], y[j] - y[i], mass[j], pullX, pullY);
+		}
+
+		forceX[i] = gravityConstant * mass[i] * pullX;
+		forceY[i] = gravityConstant * mass[i] * pullY;
+	}
+}
+
+void ComputeAttractorPull(const float* x, const float* y, std::size_t n,
+	const float* attractorX, const float* attractorY, const float* attractorMass, std::size_t count,
+	float* pullX, float* pullY)
+{
+	std::size_t i = 0;
+
+#ifdef SB_SSE
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.f);
+
+	// Bodies go in the lanes, and every attractor is broadcast to them
+	for (; i + 4 <= n; i += 4) {
+		const __m128 x4 = _mm_loadu_ps(x + i);
+		const __m128 y4 = _mm_loadu_ps(y + i);
+		__m128 pullX4 = zero;
+		__m128 pullY4 = zero;
+
+		for (std::size_t k = 0; k < count; k++) {
+			const __m128 dx = _mm_sub_ps(_mm_set1_ps(attractorX[k]), x4);
+			const __m128 dy = _mm_sub_ps(_mm_set1_ps(attractorY[k]), y4);
+			const __m128 distSq = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+
+			// Lanes at distance 0 divide by zero, and are masked out
+			const __m128 invDistCube = _mm_div_ps(one, _mm_mul_ps(distSq, _mm_sqrt_ps(distSq)));
+			const __m128 scale = _mm_and_ps(_mm_cmpgt_ps(distSq, zero), _mm_mul_ps(_mm_set1_ps(attractorMass[k]), invDistCube));
+
+			pullX4 = _mm_add_ps(pullX4, _mm_mul_ps(scale, dx));
+			pullY4 = _mm_add_ps(pullY4, _mm_mul_ps(scale, dy));
+		}
+
+		_mm_storeu_ps(pullX + i, pullX4);
+		_mm_storeu_ps(pullY + i, pullY4);
+	}
+#endif
+
+	for (; i < n; i++) {
+		float sumX = 0.f, sumY = 0.f;
+
+		for (std::size_t k = 0; k < count; k++) {
+			const float dx = attractorX[k] - x[i];
+			const float dy = attractorY[k] - y[i];
+			const float distSq = dx * dx + dy * dy;
+			if (distSq == 0.f)
+				continue;
+
+			const float scale = attractorMass[k] / (distSq * std::sqrt(distSq));
+			sumX += scale * dx;
+			sumY += scale * dy;
+		}
+
+		pullX[i] = sumX;
+		pullY[i] = sumY;
+	}
+}
+
+} // namespace Starbase
@@ -0,0 +1,29 @@
+#include <starbase/starbase.hpp>
+#include <starbase/game/interpolation.hpp>
+
+#ifdef SB_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace Starbase {
+
+void InterpolateLanes(const float* prev, const float* cur, float alpha, float* out, std::size_t count)
+{
+	std::size_t i = 0;
+
+#ifdef SB_SSE
+	const __m128 alpha4 = _mm_set1_ps(alpha);
+
+	for (; i + 4 <= count; i += 4) {
+		const __m128 prev4 = _mm_loadu_ps(prev + i);
+		const __m128 cur4 = _mm_loadu_ps(cur + i);
+		_mm_storeu_ps(out + i, _mm_add_ps(prev4, _mm_mul_ps(_mm_sub_ps(cur4, prev4), alpha4)));
+	}
+#endif
+
+	for (; i < count; i++) {
+		out[i] = prev[i] + (cur[i] - prev[i]) * alpha;
+	}
+}
+
+} // namespace Starbase
@@ -80,6 +80,27 @@ std::unique_ptr<ModelFiles> GetModelFiles(IFilesystem& fs, const std::string& pa
 	return nullptr;
 }
 
+bool GetModelConfig(IFilesystem& fs, const std::string& path, YAML::Node& cfg)
+{
+	std::string cfgPath = GetModelConfigPath(fs, path);
+
+	std::unique_ptr<std::istream> istream = fs.OpenAsStream(cfgPath);
+	if (istream != nullptr) {
+		try {
+			cfg = YAML::Load(*istream);
+			return true;
+		}
+		catch (...) {
+			LOG(error) << "Parsing yml file " << cfgPath << " failed";
+		}
+	}
+	else {
+		LOG(error) << "Could not read model config " << cfgPath;
+	}
+
+	return false;
+}
+
 glm::vec2 GetShapeCenter(const NSVGshape* shape)
 {
 	glm::vec2 center;
@@ -4,7 +4,7 @@
 
 namespace Starbase {
 
-void AutoDestructSystem::Update(int step, Entity& ent, AutoDestruct& autoDestruct)
+void AutoDestructSystem::Update(int step, Entity& ent, const AutoDestruct& autoDestruct)
 {
 	const int dieStep = autoDestruct.initialStep + autoDestruct.ttl;
 	if (step > dieStep) {
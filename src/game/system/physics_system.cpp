@@ -1,4 +1,6 @@
-#include <cmath>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 
 #include <glm/glm.hpp>
 
@@ -8,8 +10,14 @@ namespace Starbase {
 
 static const cpTransform tzero = { 0.f, 0.f, 0.f, 0.f, 0.f, 0.f };
 
-PhysicsSystem::PhysicsSystem(EventManager& eventManager)
+// Heavier than ships and everything they fire, lighter than planets
+static const cpFloat defaultAttractorMass = 10000.0;
+
+PhysicsSystem::PhysicsSystem(EventManager& eventManager, EntityManager& entityManager)
 	: m_eventManager(eventManager)
+	, m_entityManager(entityManager)
+	, m_attractorMass(defaultAttractorMass)
+	, m_threadPool(nullptr)
 {
 	eventManager.Connect<Physics, EventManager::component_added>([this](Entity& ent, Physics& physics) {
 		this->PhysicsAdded(ent, ent.GetComponent<Transform>(), physics);
@@ -17,25 +25,159 @@ PhysicsSystem::PhysicsSystem(EventManager& eventManager)
 	eventManager.Connect<Physics, EventManager::component_removed>([this](Entity& ent, Physics& physics) {
 		this->PhysicsRemoved(ent, ent.GetComponent<Transform>(), physics);
 	});
+	eventManager.Connect<EventManager::entity_removed>([this](Entity& ent) {
+		// Removed entities don't get component_removed
+		if (const Physics* physics = ent.GetComponentOrNull<Physics>())
+			m_bodyEntities.erase(physics->cp.body.get());
+	});
+	eventManager.Connect<EventManager::entities_added>([this](Entity* entities, std::size_t count) {
+		for (std::size_t i = 0; i < count; i++) {
+			Entity& ent = entities[i];
+			if (ent.HasComponent<Physics>())
+				this->PhysicsAdded(ent, ent.GetComponent<Transform>(), ent.GetComponent<Physics>());
+		}
+	});
 }
 
 void PhysicsSystem::InitSpace(id_t spaceId)
 {
-	m_spaces.insert(
-		std::make_pair(
-			spaceId,
-			std::shared_ptr<cpSpace>(cpSpaceNew(), cpSpaceDeleter())));
+	Space& space = m_spaces[spaceId];
+	space.system = this;
+	space.hasty = m_spaceParams.hasty;
+	space.threads = m_spaceParams.threads;
+
+	if (space.hasty) {
+		space.space = std::shared_ptr<cpSpace>(cpHastySpaceNew(), cpHastySpaceDeleter());
+		cpHastySpaceSetThreads(space.space.get(), space.threads);
+	} else {
+		space.space = std::shared_ptr<cpSpace>(cpSpaceNew(), cpSpaceDeleter());
+	}
+
+	cpSpaceSetIterations(space.space.get(), m_spaceParams.iterations);
+	space.gravity.SetParams(m_gravityParams);
+
+	for (const auto& pair : m_collisionPairs) {
+		InstallCollisionHandler(space, pair.first, pair.second);
+	}
+}
+
+void PhysicsSystem::SetSpaceParams(const SpaceParams& params)
+{
+	m_spaceParams = params;
+
+	for (auto& p : m_spaces) {
+		Space& space = p.second;
+		cpSpaceSetIterations(space.space.get(), params.iterations);
+		SetHastyThreads(space, params.threads);
+	}
+}
+
+unsigned long PhysicsSystem::HastyThreads(bool parallel) const
+{
+	if (!parallel)
+		return m_spaceParams.threads;
+
+	const unsigned long share = std::max<unsigned long>(1, m_threadPool->GetThreadCount() / m_spaces.size());
+	return m_spaceParams.threads != 0 ? std::min(share, m_spaceParams.threads) : share;
+}
+
+void PhysicsSystem::SetHastyThreads(Space& space, unsigned long threads)
+{
+	if (space.hasty && space.threads != threads) {
+		cpHastySpaceSetThreads(space.space.get(), threads);
+		space.threads = threads;
+	}
+}
+
+void PhysicsSystem::SetGravityParams(const GravitySolver::Params& params)
+{
+	m_gravityParams = params;
+
+	for (auto& p : m_spaces) {
+		p.second.gravity.SetParams(params);
+	}
+}
+
+void PhysicsSystem::AddCollisionHandler(id_t typeA, id_t typeB)
+{
+	m_collisionPairs.emplace_back(typeA, typeB);
+
+	for (auto& p : m_spaces) {
+		InstallCollisionHandler(p.second, typeA, typeB);
+	}
+}
+
+void PhysicsSystem::InstallCollisionHandler(Space& space, id_t typeA, id_t typeB)
+{
+	cpCollisionHandler* handler = cpSpaceAddCollisionHandler(space.space.get(), cpCollisionType(typeA), cpCollisionType(typeB));
+	handler->beginFunc = &PhysicsSystem::CollisionBegin;
+	handler->postSolveFunc = &PhysicsSystem::CollisionPostSolve;
+	handler->separateFunc = &PhysicsSystem::CollisionSeparate;
+	handler->userData = &space;
+}
+
+int PhysicsSystem::AddContact(Space& space, cpArbiter* arb, CollisionEvent::Phase phase)
+{
+	// Bodies come in the order of the collision types of the handler
+	cpBody* bodyA;
+	cpBody* bodyB;
+	cpArbiterGetBodies(arb, &bodyA, &bodyB);
+
+	// Bodies of removed entities still separate when chipmunk removes them
+	const std::unordered_map<const cpBody*, BodyEntity>& bodyEntities = space.system->m_bodyEntities;
+	const auto first = bodyEntities.find(bodyA);
+	const auto second = bodyEntities.find(bodyB);
+	if (first == bodyEntities.end() || second == bodyEntities.end())
+		return -1;
+
+	const cpContactPointSet points = cpArbiterGetContactPointSet(arb);
+	const glm::vec2 point = points.count > 0 ? to_vec2f(points.points[0].pointA) : to_vec2f(cpBodyGetPosition(bodyA));
+
+	space.contacts.emplace_back(first->second.entity, second->second.entity, phase, point);
+	return static_cast<int>(space.contacts.size()) - 1;
+}
+
+cpBool PhysicsSystem::CollisionBegin(cpArbiter* arb, cpSpace*, cpDataPointer data)
+{
+	Space& space = *static_cast<Space*>(data);
+
+	// Remember the contact, to add the impulse once the step solved it
+	const int index = AddContact(space, arb, CollisionEvent::begin);
+	cpArbiterSetUserData(arb, reinterpret_cast<cpDataPointer>(static_cast<std::intptr_t>(index + 1)));
+
+	return cpTrue;
+}
+
+void PhysicsSystem::CollisionPostSolve(cpArbiter* arb, cpSpace*, cpDataPointer data)
+{
+	if (!cpArbiterIsFirstContact(arb))
+		return;
+
+	Space& space = *static_cast<Space*>(data);
+	const std::intptr_t index = reinterpret_cast<std::intptr_t>(cpArbiterGetUserData(arb)) - 1;
+
+	if (index >= 0 && static_cast<std::size_t>(index) < space.contacts.size())
+		space.contacts[index].impulse = to_vec2f(cpArbiterTotalImpulse(arb));
+}
+
+void PhysicsSystem::CollisionSeparate(cpArbiter* arb, cpSpace*, cpDataPointer data)
+{
+	AddContact(*static_cast<Space*>(data), arb, CollisionEvent::separate);
 }
 
 void PhysicsSystem::InitBody(const Entity& ent, Transform& transf, Physics& phys)
 {
-	const Body& bodyResource = *phys.body;
-	cpSpace* space = m_spaces.at(phys.spaceId).get();
+	const Body& bodyResource = **phys.body;
+	const Scale* scale = ent.GetComponentOrNull<Scale>();
+	const glm::vec2 scaleValue = scale ? scale->value : glm::vec2(1.f, 1.f);
+	cpSpace* space = m_spaces.at(phys.spaceId).space.get();
 
 	phys.cp.body.reset(cpBodyNew(1.0, 1.0));
-	phys.cp.space = m_spaces.at(phys.spaceId);
+	phys.cp.space = m_spaces.at(phys.spaceId).space;
+	phys.cpUserData.entity = ent.id;
 
 	cpBody* body = phys.cp.body.get();
+	m_bodyEntities[body] = BodyEntity{ ent.id, phys.attractor };
 
 	cpFloat moment = 0.0;
 	cpFloat mass = bodyResource.GetMass();
@@ -49,7 +191,7 @@ void PhysicsSystem::InitBody(const Entity& ent, Transform& transf, Physics& phys
 		);
 
 		cpTransform trans = cpTransformIdentity;
-		trans = cpTransformMult(trans, cpTransformScale(transf.scale.x, transf.scale.y));
+		trans = cpTransformMult(trans, cpTransformScale(scaleValue.x, scaleValue.y));
 
 		cpShape* shape = cpPolyShapeNew(
 			body,
@@ -66,9 +208,9 @@ void PhysicsSystem::InitBody(const Entity& ent, Transform& transf, Physics& phys
 		phys.cp.shapes.emplace_back(cpShapeUniquePtr(shape));
 	}
 	for (const Body::CircleShape& circle : bodyResource.GetCircleShapes()) {
-		const cpVect offs = to_cpv(circle.pos * glm::tvec2<cpFloat>(transf.scale));
+		const cpVect offs = to_cpv(circle.pos * glm::tvec2<cpFloat>(scaleValue));
 		moment += cpMomentForCircle(mass, 0.f, circle.radius, offs);
-		cpShape* shape = cpCircleShapeNew(body, circle.radius * transf.scale.x, offs);
+		cpShape* shape = cpCircleShapeNew(body, circle.radius * scaleValue.x, offs);
 		cpCircleShape* cshape = (cpCircleShape*)shape;
 		phys.cp.shapes.emplace_back(cpShapeUniquePtr(shape));
 	}
@@ -81,7 +223,9 @@ void PhysicsSystem::InitBody(const Entity& ent, Transform& transf, Physics& phys
 	for (auto& it : phys.cp.shapes) {
 		cpShape* shape = it.get();
 
-		const cpFloat friction = phys.body->GetFriction();
+		cpShapeSetCollisionType(shape, cpCollisionType(phys.collisionType));
+
+		const cpFloat friction = (*phys.body)->GetFriction();
 		if (friction) {
 			cpShapeSetFriction(shape, friction);
 		}
@@ -98,8 +242,7 @@ void PhysicsSystem::InitBody(const Entity& ent, Transform& transf, Physics& phys
 
 	
 
-	//cpBodyApplyForceAtWorldPoint(body, to_cpv(transf.vel), cpvzero);
-	cpBodySetVelocity(body, to_cpv(transf.vel));
+	cpBodySetVelocity(body, to_cpv(phys.initialVel));
 }
 
 void PhysicsSystem::PhysicsAdded(const Entity& ent, Transform& transf, Physics& phys)
@@ -113,66 +256,153 @@ void PhysicsSystem::PhysicsAdded(const Entity& ent, Transform& transf, Physics&
 
 void PhysicsSystem::PhysicsRemoved(const Entity& ent, Transform& transf, Physics& phys)
 {
+	m_bodyEntities.erase(phys.cp.body.get());
+
 	// we stil leak spaces here.
 }
 
-void PhysicsSystem::ApplyGravity(cpSpace* space, float dt)
+void PhysicsSystem::ApplyGravity(Space& space, float dt) const
 {
-	const static cpFloat gravityConstant = 20.0;
+	GravityBodies& g = space.gravityBodies;
+	g.attractors.clear();
+	g.x.clear();
+	g.y.clear();
+	g.mass.clear();
+	g.attractorPoints.Clear();
+	g.particles.clear();
+	g.particlePoints.Clear();
+
+	cpSpaceEachBody(space.space.get(), [](cpBody* body, void* data) {
+		Space& space = *static_cast<Space*>(data);
+		const PhysicsSystem& system = *space.system;
+		GravityBodies& g = space.gravityBodies;
+		const cpVect pos = cpBodyGetPosition(body);
+		const cpFloat mass = cpBodyGetMass(body);
+		const GravityPoint point = { static_cast<float>(pos.x), static_cast<float>(pos.y), static_cast<float>(mass) };
+
+		const auto iter = system.m_bodyEntities.find(body);
+		const bool flagged = iter != system.m_bodyEntities.end() && iter->second.attractor;
+
+		if (flagged || mass >= system.m_attractorMass) {
+			g.attractors.push_back(body);
+			g.x.push_back(pos.x);
+			g.y.push_back(pos.y);
+			g.mass.push_back(mass);
+			g.attractorPoints.PushBack(point);
+		} else {
+			g.particles.push_back(body);
+			g.particlePoints.PushBack(point);
+		}
+	}, &space);
 
-	struct gcontext {
-		cpSpace* space;
-		cpBody* tgtBody;
-	} ctx;
+	const std::size_t attractorCount = g.attractors.size();
+	if (attractorCount == 0)
+		return;
 
-	ctx.space = space;
+	const cpFloat gravityConstant = m_gravityParams.gravityConstant;
 
-	cpSpaceEachBody(space, [](cpBody* tgtBody, void* ctx_) {
-		gcontext* ctx = (gcontext*) ctx_;
-		ctx->tgtBody = tgtBody;
+	g.forceX.resize(attractorCount);
+	g.forceY.resize(attractorCount);
+	space.gravity.Compute(g.x.data(), g.y.data(), g.mass.data(), attractorCount, g.forceX.data(), g.forceY.data());
 
-		cpSpaceEachBody(ctx->space, [](cpBody* srcBody, void* ctx_) {
-			gcontext* ctx = (gcontext*) ctx_;
+	for (std::size_t i = 0; i < attractorCount; i++) {
+		cpBody* body = g.attractors[i];
+		const cpVect center = cpvadd(cpv(g.x[i], g.y[i]), cpBodyGetCenterOfGravity(body));
+		cpBodyApplyForceAtWorldPoint(body, cpv(g.forceX[i], g.forceY[i]), center);
+	}
 
-			if (srcBody == ctx->tgtBody) return;
+	using Lanes = TSoAVector<GravityPoint>;
+	const std::size_t laneX = Lanes::LaneOf(offsetof(GravityPoint, x));
+	const std::size_t laneY = Lanes::LaneOf(offsetof(GravityPoint, y));
+	const std::size_t laneMass = Lanes::LaneOf(offsetof(GravityPoint, mass));
+
+	const std::size_t particleCount = g.particles.size();
+	g.pullX.resize(particleCount);
+	g.pullY.resize(particleCount);
+	ComputeAttractorPull(
+		g.particlePoints.Lane(laneX), g.particlePoints.Lane(laneY), particleCount,
+		g.attractorPoints.Lane(laneX), g.attractorPoints.Lane(laneY), g.attractorPoints.Lane(laneMass), attractorCount,
+		g.pullX.data(), g.pullY.data()
+	);
+
+	for (std::size_t i = 0; i < particleCount; i++) {
+		cpBody* body = g.particles[i];
+		const cpFloat scale = gravityConstant * cpBodyGetMass(body);
+		const cpVect center = cpvadd(cpBodyGetPosition(body), cpBodyGetCenterOfGravity(body));
+		cpBodyApplyForceAtWorldPoint(body, cpv(scale * g.pullX[i], scale * g.pullY[i]), center);
+	}
+}
+
+void PhysicsSystem::SyncTransform(const Entity& ent, Transform& transf, const cpBody* body)
+{
+	// Sleeping bodies don't move, so skip them without computing the angle
+	if (transf.prevPos == transf.pos && cpBodyIsSleeping(body))
+		return;
+
+	const glm::vec2 pos = to_vec2f(cpBodyGetPosition(body));
+	const float rot = static_cast<float>(cpvtoangle(cpBodyGetRotation(body)));
+	if (pos == transf.pos && rot == transf.rot && transf.prevPos == transf.pos)
+		return;
 
-			const cpFloat tgtMass = cpBodyGetMass(ctx->tgtBody);
-			const cpFloat srcMass = cpBodyGetMass(srcBody);
-			const cpVect tgtPos = cpBodyGetPosition(ctx->tgtBody);
-			const cpVect srcPos = cpBodyGetPosition(srcBody);
-			const cpFloat dist = cpvdist(srcPos, tgtPos);
+	transf.prevPos = transf.pos;
+	transf.pos = pos;
+	transf.rot = rot;
+	ent.MarkChanged<Transform>();
+}
+
+void PhysicsSystem::StepSpace(Space& space, float dt) const
+{
+	if (space.hasty)
+		cpHastySpaceStep(space.space.get(), dt);
+	else
+		cpSpaceStep(space.space.get(), dt);
 
+	ApplyGravity(space, dt);
 
-			cpFloat vel = gravityConstant * ((tgtMass * srcMass) / std::pow(dist, 2));
-			cpFloat dir = std::atan2(srcPos.y - tgtPos.y, srcPos.x - tgtPos.x);
-			cpVect force = cpv(std::cos(dir) * vel, std::sin(dir) * vel);
-			//ctx->force = cpvadd(ctx->force, force);
+	cpSpaceEachBody(space.space.get(), [](cpBody* body, void* data) {
+		const PhysicsSystem& system = *static_cast<Space*>(data)->system;
 
-			const cpVect tgtCenter = cpBodyGetCenterOfGravity(ctx->tgtBody);
-			cpBodyApplyForceAtWorldPoint(ctx->tgtBody, force, cpvadd(tgtPos, tgtCenter));
-		}, ctx);
+		const auto iter = system.m_bodyEntities.find(body);
+		if (iter == system.m_bodyEntities.end())
+			return;
 
-		
-	}, &ctx);
+		if (const Entity* ent = system.m_entityManager.GetEntityOrNull(iter->second.entity))
+			SyncTransform(*ent, ent->GetComponent<Transform>(), body);
+	}, &space);
 }
 
 void PhysicsSystem::Simulate(float dt)
 {
-	for (const auto& p : m_spaces) {
-		cpSpace* space = p.second.get();
-		cpSpaceStep(space, dt);
+	const bool parallel = m_threadPool && m_spaces.size() > 1;
+	const unsigned long threads = HastyThreads(parallel);
+
+	if (parallel) {
+		m_spaceJobs.clear();
+		for (auto& p : m_spaces) {
+			SetHastyThreads(p.second, threads);
+			m_spaceJobs.push_back(&p.second);
+		}
 
-		ApplyGravity(space, dt);
+		m_threadPool->ParallelFor(m_spaceJobs.size(), 1, [this, dt](std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; i++) {
+				StepSpace(*m_spaceJobs[i], dt);
+			}
+		});
+	} else {
+		for (auto& p : m_spaces) {
+			SetHastyThreads(p.second, threads);
+			StepSpace(p.second, dt);
+		}
 	}
-}
 
-void PhysicsSystem::Update(Entity& ent, Transform& transf, Physics& phys)
-{
-	cpBody* body = phys.cp.body.get();
-	transf.prevPos = transf.pos;
-	transf.pos = to_vec2f(cpBodyGetPosition(body));
-	transf.rot = static_cast<float>(cpvtoangle(cpBodyGetRotation(body)));
-	transf.vel = to_vec2f(cpBodyGetVelocity(body));
+	// Queued afterwards, so the batches come in the same order either way
+	for (auto& p : m_spaces) {
+		Space& space = p.second;
+		if (!space.contacts.empty()) {
+			m_eventManager.QueueBatch<CollisionEvent>(space.contacts.data(), space.contacts.size());
+			space.contacts.clear();
+		}
+	}
 }
 
 PhysicsSystem::~PhysicsSystem()
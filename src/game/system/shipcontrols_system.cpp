@@ -20,43 +20,24 @@ cpBodyApplyTorque(cpBody *body, cpFloat torque)
 
 void ShipControlsSystem::SpawnBullet(int step, const id_t spaceId, const glm::vec2& pos, const glm::vec2& vel)
 {
-	ResourcePtr<Model> model = m_resourceLoader.Load<Model>(ID("models/bullets/bullet-0"));
-	ResourcePtr<Body> body = m_resourceLoader.Load<Body>(ID("models/bullets/bullet-0"));
-
-	Transform transf;
-	transf.pos = pos;
-	//transf.rot = rot;
-	transf.scale = glm::vec2(10.f, 10.f);
-	transf.vel = vel;
-
-    m_em.CreateEntity<Transform, Renderable, Physics, AutoDestruct>(
-        Transform(transf),
-		Renderable{model},
-		Physics{spaceId, body},
-		AutoDestruct(step, 400)
-	);
-
-	/*
-    std::tuple<Entity&, Transform&> bullet = m_em.CreateEntity<Transform>();
-
-    Entity& entity = std::get<0>(bullet);
-    Transform& transf = std::get<1>(bullet);
-    transf.pos = pos;
-    //transf.rot = rot;
-    transf.scale = glm::vec2(10.f, 10.f);
-    transf.vel = vel;
-
-    ResourcePtr<Model> modelPtr = m_resourceLoader.Load<Model>(ID("models/bullets/bullet-0"));
-    ResourcePtr<Body> bodyPtr = m_resourceLoader.Load<Body>(ID("models/bullets/bullet-0"));
-
-    m_em.AddComponent<Renderable>(entity, Renderable{modelPtr});
-    m_em.AddComponent<Physics>(entity, ID("default"), bodyPtr);*/
+	if (SB_UNLIKELY(!m_bulletPrefab))
+		m_bulletPrefab = &m_prefabs.Load(ID("models/bullets/bullet-0"));
+
+	std::tuple<Entity&, Transform&, Physics&, AutoDestruct&> bullet =
+		m_em.Instantiate<Transform, Physics, AutoDestruct>(*m_bulletPrefab);
+
+	std::get<1>(bullet).pos = pos;
+
+	Physics& phys = std::get<2>(bullet);
+	phys.spaceId = spaceId;
+	phys.initialVel = vel;
+	std::get<3>(bullet).initialStep = step;
 }
 
 static std::pair<glm::vec2, glm::vec2> GetBulletSpawnPosAndVel(Entity& ent, const Transform& transf, Physics& phys)
 {
-	if (!phys.body->GetHardpoints().empty()) {
-		Body::Hardpoint hp = phys.body->GetHardpoints().front();
+	if (!(*phys.body)->GetHardpoints().empty()) {
+		Body::Hardpoint hp = (*phys.body)->GetHardpoints().front();
 		float s = std::sin(transf.rot);
 		float c = std::cos(transf.rot);
 
@@ -72,7 +53,7 @@ static std::pair<glm::vec2, glm::vec2> GetBulletSpawnPosAndVel(Entity& ent, cons
 			300.0 * std::sin(transf.rot - 1.5708)
 		);
 
-		vel += transf.vel;
+		vel += to_vec2f(cpBodyGetVelocity(phys.cp.body.get()));
 
 		return std::make_pair(pos, vel);
 	}
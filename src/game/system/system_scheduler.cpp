@@ -0,0 +1,97 @@
+#include <chrono>
+
+#include <starbase/game/logging.hpp>
+#include <starbase/game/system/system_scheduler.hpp>
+
+namespace Starbase {
+
+bool SystemScheduler::Access::ConflictsWith(const Access& other) const
+{
+	if (exclusive || other.exclusive)
+		return true;
+
+	return (writes & (other.reads | other.writes)).any()
+		|| (other.writes & reads).any();
+}
+
+SystemScheduler::SystemScheduler(ThreadPool& threadPool)
+	: m_threadPool(threadPool)
+{}
+
+void SystemScheduler::Add(const std::string& name, const Access& access, system_function fun)
+{
+	const std::size_t index = m_systems.size();
+
+	System system;
+	system.name = name;
+	system.access = access;
+	system.fun = std::move(fun);
+	system.numDependencies = 0;
+
+	for (System& earlier : m_systems) {
+		if (earlier.access.ConflictsWith(access)) {
+			earlier.dependents.push_back(index);
+			system.numDependencies++;
+		}
+	}
+
+	m_systems.push_back(std::move(system));
+}
+
+void SystemScheduler::RunSystem(System& system)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	system.fun();
+
+	const auto end = std::chrono::steady_clock::now();
+	const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+	system.timing.lastMs = ms;
+	system.timing.averageMs = system.timing.averageMs * 0.95 + ms * 0.05;
+}
+
+void SystemScheduler::Run()
+{
+	m_pending.resize(m_systems.size());
+	m_ready.clear();
+
+	for (std::size_t i = 0; i < m_systems.size(); i++) {
+		m_pending[i] = m_systems[i].numDependencies;
+		if (m_pending[i] == 0)
+			m_ready.push_back(i);
+	}
+
+	// Dependencies always point to earlier systems, so every system gets ready
+	while (!m_ready.empty()) {
+		m_wave.swap(m_ready);
+		m_ready.clear();
+
+		if (m_wave.size() == 1) {
+			RunSystem(m_systems[m_wave.front()]);
+		}
+		else {
+			m_threadPool.ParallelFor(m_wave.size(), 1, [this](std::size_t begin, std::size_t end) {
+				for (std::size_t i = begin; i < end; i++) {
+					RunSystem(m_systems[m_wave[i]]);
+				}
+			});
+		}
+
+		for (std::size_t index : m_wave) {
+			for (std::size_t dependent : m_systems[index].dependents) {
+				if (--m_pending[dependent] == 0)
+					m_ready.push_back(dependent);
+			}
+		}
+	}
+}
+
+void SystemScheduler::LogTimings() const
+{
+	ForEachTiming([](const std::string& name, const Timing& timing) {
+		LOG(trace) << "System " << name << ": " << timing.lastMs << " ms (avg " << timing.averageMs << " ms)";
+	});
+}
+
+} // namespace Starbase
@@ -0,0 +1,123 @@
+#include <algorithm>
+
+#include <starbase/game/thread_pool.hpp>
+
+namespace Starbase {
+
+static thread_local bool t_inParallelFor = false;
+
+std::size_t ThreadPool::DefaultWorkerCount()
+{
+	const std::size_t hardwareThreads = std::thread::hardware_concurrency();
+	return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+}
+
+ThreadPool::ThreadPool(std::size_t numWorkers)
+	: m_quit(false)
+{
+	m_workers.reserve(numWorkers);
+	for (std::size_t i = 0; i < numWorkers; i++) {
+		m_workers.emplace_back(&ThreadPool::WorkerMain, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_wake.notify_all();
+
+	for (std::thread& worker : m_workers) {
+		worker.join();
+	}
+}
+
+bool ThreadPool::InParallelFor()
+{
+	return t_inParallelFor;
+}
+
+void ThreadPool::RunGrains(Job& job)
+{
+	while (true) {
+		const std::size_t begin = job.next.fetch_add(job.grainSize);
+		if (begin >= job.count)
+			break;
+
+		(*job.fun)(begin, std::min(begin + job.grainSize, job.count));
+	}
+}
+
+ThreadPool::Job* ThreadPool::FindJob() const
+{
+	for (Job* job : m_jobs) {
+		if (job->next.load() < job->count)
+			return job;
+	}
+	return nullptr;
+}
+
+void ThreadPool::WorkerMain()
+{
+	// Workers only ever run ranges
+	t_inParallelFor = true;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true) {
+		Job* job = nullptr;
+		m_wake.wait(lock, [&] { return m_quit || (job = FindJob()) != nullptr; });
+		if (m_quit)
+			break;
+
+		job->busy++;
+		lock.unlock();
+
+		RunGrains(*job);
+
+		lock.lock();
+		if (--job->busy == 0)
+			m_done.notify_all();
+	}
+}
+
+void ThreadPool::ParallelFor(std::size_t count, std::size_t grainSize, const range_function& fun)
+{
+	if (count == 0)
+		return;
+
+	if (grainSize == 0)
+		grainSize = 1;
+
+	if (m_workers.empty() || count <= grainSize) {
+		fun(0, count);
+		return;
+	}
+
+	Job job;
+	job.fun = &fun;
+	job.count = count;
+	job.grainSize = grainSize;
+	job.next = 0;
+	job.busy = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back(&job);
+	}
+	m_wake.notify_all();
+
+	const bool nested = t_inParallelFor;
+	t_inParallelFor = true;
+	RunGrains(job);
+	t_inParallelFor = nested;
+
+	// Workers only join the job while it's listed, so once it's removed and
+	// none of them is busy, none will touch it anymore
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_jobs.erase(std::find(m_jobs.begin(), m_jobs.end(), &job));
+	m_done.wait(lock, [&] { return job.busy == 0; });
+}
+
+} // namespace Starbase
@@ -0,0 +1,232 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <starbase/game/gravity.hpp>
+
+// Compares the Barnes-Hut gravity of GravitySolver, at several opening
+// angles, with its exact mode and with the pairwise loop it replaced in
+// PhysicsSystem::ApplyGravity. Errors are relative to the exact forces.
+// Also compares ComputeAttractorPull, where only the heavy bodies pull, with
+// the same sum done in doubles. Prints the results as JSON on stdout:
+//
+//   starbase_gravity_bench [max bodies] > results.json
+
+using namespace Starbase;
+
+namespace {
+
+struct Bodies {
+	std::vector<double> x, y, mass;
+};
+
+struct Result {
+	std::string method;
+	double theta;
+	std::size_t bodies;
+	double ms;
+	double rmsError; // of |F - F_exact| / |F_exact|
+	double maxError;
+};
+
+using clock_type = std::chrono::steady_clock;
+
+const double GRAVITY_CONSTANT = 20.0;
+
+// A few heavy bodies among many light ones, spread like a scene
+Bodies MakeBodies(std::size_t count, unsigned seed)
+{
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<double> position(-5000.0, 5000.0);
+	std::uniform_real_distribution<double> lightMass(1.0, 10.0);
+	std::uniform_real_distribution<double> heavyMass(1000.0, 100000.0);
+
+	Bodies bodies;
+	for (std::size_t i = 0; i < count; i++) {
+		bodies.x.push_back(position(rng));
+		bodies.y.push_back(position(rng));
+		bodies.mass.push_back(i % 100 == 0 ? heavyMass(rng) : lightMass(rng));
+	}
+	return bodies;
+}
+
+// The loop of PhysicsSystem::ApplyGravity before the solver
+void Pairwise(const Bodies& bodies, std::vector<double>& forceX, std::vector<double>& forceY)
+{
+	const std::size_t count = bodies.x.size();
+	for (std::size_t tgt = 0; tgt < count; tgt++) {
+		forceX[tgt] = forceY[tgt] = 0.0;
+
+		for (std::size_t src = 0; src < count; src++) {
+			if (src == tgt) continue;
+
+			const double dist = std::hypot(bodies.x[src] - bodies.x[tgt], bodies.y[src] - bodies.y[tgt]);
+			const double vel = GRAVITY_CONSTANT * ((bodies.mass[tgt] * bodies.mass[src]) / std::pow(dist, 2));
+			const double dir = std::atan2(bodies.y[src] - bodies.y[tgt], bodies.x[src] - bodies.x[tgt]);
+			forceX[tgt] += std::cos(dir) * vel;
+			forceY[tgt] += std::sin(dir) * vel;
+		}
+	}
+}
+
+template<typename F>
+double MeasureMs(F fun)
+{
+	// Best of a few runs
+	double best = std::numeric_limits<double>::max();
+	for (int i = 0; i < 3; i++) {
+		const clock_type::time_point start = clock_type::now();
+		fun();
+		best = std::min(best, std::chrono::duration<double, std::milli>(clock_type::now() - start).count());
+	}
+	return best;
+}
+
+void SetErrors(Result& result, const std::vector<double>& forceX, const std::vector<double>& forceY,
+	const std::vector<double>& exactX, const std::vector<double>& exactY)
+{
+	double sumSq = 0.0;
+	result.maxError = 0.0;
+
+	for (std::size_t i = 0; i < forceX.size(); i++) {
+		const double exact = std::hypot(exactX[i], exactY[i]);
+		const double error = exact > 0.0 ? std::hypot(forceX[i] - exactX[i], forceY[i] - exactY[i]) / exact : 0.0;
+		sumSq += error * error;
+		result.maxError = std::max(result.maxError, error);
+	}
+
+	result.rmsError = std::sqrt(sumSq / static_cast<double>(std::max<std::size_t>(forceX.size(), 1)));
+}
+
+void Run(std::size_t count, std::vector<Result>& results)
+{
+	const Bodies bodies = MakeBodies(count, 42);
+	std::vector<double> exactX(count), exactY(count);
+	std::vector<double> forceX(count), forceY(count);
+
+	GravitySolver solver;
+	GravitySolver::Params params;
+	params.gravityConstant = GRAVITY_CONSTANT;
+
+	params.exact = true;
+	solver.SetParams(params);
+	Result exact{ "exact", 0.0, count, 0.0, 0.0, 0.0 };
+	exact.ms = MeasureMs([&] {
+		solver.Compute(bodies.x.data(), bodies.y.data(), bodies.mass.data(), count, exactX.data(), exactY.data());
+	});
+	results.push_back(exact);
+
+	Result pairwise{ "pairwise", 0.0, count, 0.0, 0.0, 0.0 };
+	pairwise.ms = MeasureMs([&] { Pairwise(bodies, forceX, forceY); });
+	SetErrors(pairwise, forceX, forceY, exactX, exactY);
+	results.push_back(pairwise);
+
+	params.exact = false;
+	for (double theta : { 0.3, 0.5, 0.7, 1.0 }) {
+		params.theta = theta;
+		solver.SetParams(params);
+
+		Result tree{ "barnes_hut", theta, count, 0.0, 0.0, 0.0 };
+		tree.ms = MeasureMs([&] {
+			solver.Compute(bodies.x.data(), bodies.y.data(), bodies.mass.data(), count, forceX.data(), forceY.data());
+		});
+		SetErrors(tree, forceX, forceY, exactX, exactY);
+		results.push_back(tree);
+	}
+}
+
+// Only the heavy bodies of MakeBodies() pull, on all the others
+void RunAttractors(std::size_t count, std::vector<Result>& results)
+{
+	const Bodies bodies = MakeBodies(count, 42);
+
+	std::vector<float> x, y, attractorX, attractorY, attractorMass;
+	std::vector<double> mass;
+	for (std::size_t i = 0; i < count; i++) {
+		if (i % 100 == 0) {
+			attractorX.push_back(static_cast<float>(bodies.x[i]));
+			attractorY.push_back(static_cast<float>(bodies.y[i]));
+			attractorMass.push_back(static_cast<float>(bodies.mass[i]));
+		} else {
+			x.push_back(static_cast<float>(bodies.x[i]));
+			y.push_back(static_cast<float>(bodies.y[i]));
+			mass.push_back(bodies.mass[i]);
+		}
+	}
+
+	const std::size_t particles = x.size();
+	const std::size_t attractors = attractorX.size();
+	std::vector<double> exactX(particles), exactY(particles);
+	std::vector<double> forceX(particles), forceY(particles);
+	std::vector<float> pullX(particles), pullY(particles);
+
+	Result scalar{ "attractors_double", 0.0, count, 0.0, 0.0, 0.0 };
+	scalar.ms = MeasureMs([&] {
+		for (std::size_t i = 0; i < particles; i++) {
+			double sumX = 0.0, sumY = 0.0;
+			for (std::size_t k = 0; k < attractors; k++) {
+				const double dx = static_cast<double>(attractorX[k]) - x[i];
+				const double dy = static_cast<double>(attractorY[k]) - y[i];
+				const double distSq = dx * dx + dy * dy;
+				const double scale = attractorMass[k] / (distSq * std::sqrt(distSq));
+				sumX += scale * dx;
+				sumY += scale * dy;
+			}
+			exactX[i] = GRAVITY_CONSTANT * mass[i] * sumX;
+			exactY[i] = GRAVITY_CONSTANT * mass[i] * sumY;
+		}
+	});
+	results.push_back(scalar);
+
+	Result kernel{ "attractors_kernel", 0.0, count, 0.0, 0.0, 0.0 };
+	kernel.ms = MeasureMs([&] {
+		ComputeAttractorPull(x.data(), y.data(), particles,
+			attractorX.data(), attractorY.data(), attractorMass.data(), attractors,
+			pullX.data(), pullY.data());
+	});
+	for (std::size_t i = 0; i < particles; i++) {
+		forceX[i] = GRAVITY_CONSTANT * mass[i] * pullX[i];
+		forceY[i] = GRAVITY_CONSTANT * mass[i] * pullY[i];
+	}
+	SetErrors(kernel, forceX, forceY, exactX, exactY);
+	results.push_back(kernel);
+}
+
+void PrintJson(const std::vector<Result>& results)
+{
+	std::printf("{\n\t\"gravity\": [\n");
+	for (std::size_t i = 0; i < results.size(); i++) {
+		const Result& result = results[i];
+		std::printf("\t\t{ \"method\": \"%s\", \"theta\": %.2f, \"bodies\": %zu, \"ms\": %.3f, \"rms_error\": %.6f, \"max_error\": %.6f }%s\n",
+			result.method.c_str(),
+			result.theta,
+			result.bodies,
+			result.ms,
+			result.rmsError,
+			result.maxError,
+			i + 1 < results.size() ? "," : "");
+	}
+	std::printf("\t]\n}\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+	const std::size_t maxBodies = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 8000;
+
+	std::vector<Result> results;
+	for (std::size_t count = 500; count <= maxBodies; count *= 2) {
+		Run(count, results);
+		RunAttractors(count, results);
+	}
+
+	PrintJson(results);
+	return 0;
+}